@@ -0,0 +1,507 @@
+#include "FamiTrackerModule.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+#include "HeadlessRenderer.h"
+#include "AudioSink.h"
+#include "FrameProfiler.h"
+#include "TraceRecorder.h"
+#include "TraceRenderer.h"
+#include "APU/RegisterTrace.h"
+#include "APU/VGMWriter.h"
+#include "SimpleFile.h"
+#include "WaveStream.h"
+#include "WaveRenderer.h"
+#include "WaveRendererFactory.h"
+#include "ModuleException.h"
+
+#include "FamiTrackerDocIO.h"
+#include "FamiTrackerDocOldIO.h"
+#include "DocumentFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+struct stRenderOptions {
+	int track = -1;
+	render_type_t type = render_type_t::Loops;
+	unsigned param = 1u;
+	unsigned jobs = 0u;
+	std::string sink;		// play through CAudioDriver into this sink instead of writing the file directly
+	fs::path trace;			// write a Chrome trace of the whole run here
+	stRenderSettings settings;
+};
+
+struct stRenderJob {
+	fs::path input;
+	unsigned track;
+	fs::path output;
+};
+
+struct stRenderResult {
+	bool ok = false;
+	unsigned frames = 0u;
+	std::size_t samples = 0u;
+	double elapsed = 0.;
+	std::string error;
+	std::string warning;
+	std::string profile;
+};
+
+void PrintUsage() {
+	std::cerr <<
+		"Usage: ft0cc-render [options] input output.wav\n"
+		"       ft0cc-render [options] -o outdir input...\n"
+		"Inputs ending in .trace are register traces written with -w.\n"
+		"Options:\n"
+		"  -t track    render only this track (default: first track, or all tracks with -o)\n"
+		"  -l loops    render this many loops (default: 1)\n"
+		"  -s seconds  render this many seconds\n"
+		"  -r rate     sample rate (default: 44100)\n"
+		"  -b bits     sample size, 8 or 16 (default: 16)\n"
+		"  -f          write unclipped 32-bit float samples instead (not with -d)\n"
+		"  -q quality  synthesis quality, fast, good or high (default: good)\n"
+		"  -o outdir   batch mode, writes outdir/<name>_<track>.wav for each job\n"
+		"  -j jobs     number of worker threads in batch mode (default: all cores)\n"
+		"  -m          also write <output>_<channel>.wav for each channel\n"
+		"  -w          also write <output>.trace with every APU register write\n"
+		"  -g          also write <output>.vgm\n"
+		"  -P          print per-frame timings of the driver, chips and mixer (modules only)\n"
+		"  -T file     write a timeline of the whole run as Chrome trace-event JSON\n"
+		"  -c channels 1 for mono, 2 for stereo (default: 1)\n"
+		"  -p CH=pan   pan a channel, e.g. PU1=-50, from -100 (left) to 100 (right); implies -c 2\n"
+		"  -d sink     play through the tracker's audio driver into a sink instead, one input only:\n"
+		"              null (discard, for timing), pipe (raw PCM on stdout, no output file)\n"
+		"              or wav (write output.wav through the driver)\n";
+}
+
+void LoadModule(CFamiTrackerModule &modfile, const fs::path &fname) {
+	CDocumentFile f;
+	f.Open(fname, std::ios::in | std::ios::binary);
+	f.ValidateFile();
+
+	if (f.GetFileVersion() < 0x0200U) {
+		if (!compat::OpenDocumentOld(modfile, f.GetCSimpleFile()))
+			f.RaiseModuleException("General error");
+	}
+	else if (!CFamiTrackerDocIO {f, module_error_level_t::MODULE_ERROR_DEFAULT}.Load(modfile))
+		f.RaiseModuleException("Failed to load module");
+}
+
+// names the chips that the VGM output had to leave out
+std::string GetVGMWarning(const CVGMWriter *pWriter) {
+	if (!pWriter || !pWriter->GetUnsupportedChips().HasChips())
+		return "";
+	std::string names;
+	FTEnv.GetSoundChipService()->ForeachType([&] (sound_chip_t chip) {
+		if (!pWriter->GetUnsupportedChips().ContainsChip(chip))
+			return;
+		if (!names.empty())
+			names += ", ";
+		names += FTEnv.GetSoundChipService()->GetChipShortName(chip);
+	});
+	return "VGM output does not include " + names;
+}
+
+// one row per section and chip that ran, in microseconds per frame
+std::string FormatProfile(const CFrameProfiler *pProfiler) {
+	if (!pProfiler)
+		return "";
+	std::string out;
+	char buf[128];
+	std::snprintf(buf, std::size(buf), "  %-24s %8s %10s %10s %10s\n", "Section (us/frame)", "frames", "p50", "p99", "max");
+	out += buf;
+	auto addRow = [&] (profile_section_t section, sound_chip_t chip) {
+		stProfileStats stats = pProfiler->GetStats(section, chip);
+		if (!stats.Frames)
+			return;
+		std::string name = CFrameProfiler::GetSectionName(section);
+		if (chip != sound_chip_t::none)
+			name = "  " + std::string {FTEnv.GetSoundChipService()->GetChipShortName(chip)};
+		std::snprintf(buf, std::size(buf), "  %-24s %8llu %10.1f %10.1f %10.1f\n", name.c_str(),
+			static_cast<unsigned long long>(stats.Frames), stats.P50, stats.P99, stats.Max);
+		out += buf;
+	};
+	for (auto section : enum_values<profile_section_t>()) {
+		if (!CFrameProfiler::IsPerChip(section)) {
+			addRow(section, sound_chip_t::none);
+			continue;
+		}
+		std::snprintf(buf, std::size(buf), "  %s\n", CFrameProfiler::GetSectionName(section));
+		out += buf;
+		FTEnv.GetSoundChipService()->ForeachType([&] (sound_chip_t chip) {
+			addRow(section, chip);
+		});
+	}
+	return out;
+}
+
+bool IsTrace(const fs::path &fname) {
+	return fname.extension() == ".trace";
+}
+
+// traces are always rendered whole, without stems
+stRenderResult RenderTraceJob(const stRenderJob &job, const stRenderOptions &opt) {
+	stRenderResult res;
+	try {
+		CRegisterTrace trace;
+		CSimpleFile file {job.input, std::ios::in | std::ios::binary};
+		if (!file || !trace.Read(file)) {
+			res.error = "Invalid register trace";
+			return res;
+		}
+
+		CTraceRenderer renderer {trace, opt.settings};
+		auto t0 = std::chrono::steady_clock::now();
+		if (!renderer.RenderToFile(job.output)) {
+			res.error = "Could not open output file";
+			return res;
+		}
+		res.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		res.frames = renderer.GetRenderedFrames();
+		res.samples = renderer.GetRenderedSamples();
+		res.warning = GetVGMWarning(renderer.GetVGMWriter());
+		res.ok = true;
+	}
+	catch (std::exception &e) {
+		res.error = std::string("C++ exception: ") + e.what();
+	}
+	return res;
+}
+
+// blocks of 1/100 s, as with the tracker's default buffer settings
+std::unique_ptr<CAudioSink> MakeSink(const stRenderOptions &opt, const fs::path &output) {
+	const auto &s = opt.settings;
+	int BlockSize = static_cast<int>(s.SampleRate / 100u * s.Channels * (s.SampleSize / 8u));
+
+	if (opt.sink == "null")
+		return std::make_unique<CNullAudioSink>(s.SampleRate, BlockSize);
+	if (opt.sink == "pipe")
+		return std::make_unique<CPipeAudioSink>(stdout, s.SampleRate, BlockSize);
+	if (opt.sink == "wav") {
+		auto pFile = std::make_shared<CSimpleFile>(output, std::ios::out | std::ios::binary);
+		if (!*pFile)
+			return nullptr;
+		CWaveFileFormat fmt {CWaveFileFormat::format_code::pcm, static_cast<std::uint16_t>(s.Channels),
+			static_cast<std::uint32_t>(s.SampleRate), static_cast<std::uint16_t>(s.SampleSize)};
+		return std::make_unique<CWaveAudioSink>(std::make_unique<COutputWaveStream>(pFile, fmt),
+			s.SampleSize, s.SampleRate, BlockSize);
+	}
+	return nullptr;
+}
+
+// every job loads its own copy of the module so that no state is shared between workers
+stRenderResult RenderJob(const stRenderJob &job, const stRenderOptions &opt) {
+	if (IsTrace(job.input))
+		return RenderTraceJob(job, opt);
+
+	stRenderResult res;
+	try {
+		CFamiTrackerModule modfile;
+		LoadModule(modfile, job.input);
+		if (job.track >= modfile.GetSongCount()) {
+			res.error = "Track number out of range";
+			return res;
+		}
+
+		auto pRender = std::shared_ptr<CWaveRenderer>(CWaveRendererFactory::Make(modfile, job.track, opt.type, opt.param));
+		pRender->SetRenderTrack(job.track);
+
+		CHeadlessRenderer renderer {modfile, opt.settings};
+		auto t0 = std::chrono::steady_clock::now();
+		if (!(opt.sink.empty() ? renderer.RenderToFile(job.output, pRender) :
+			renderer.RenderToSink(MakeSink(opt, job.output), pRender))) {
+			res.error = "Could not open output file";
+			return res;
+		}
+		res.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		res.frames = renderer.GetRenderedFrames();
+		res.samples = renderer.GetRenderedSamples();
+		res.warning = GetVGMWarning(renderer.GetVGMWriter());
+		res.profile = FormatProfile(renderer.GetProfiler());
+		res.ok = true;
+	}
+	catch (CModuleException &e) {
+		res.error = e.GetErrorString();
+	}
+	catch (std::exception &e) {
+		res.error = std::string("C++ exception: ") + e.what();
+	}
+	return res;
+}
+
+void PrintResult(const stRenderJob &job, const stRenderResult &res, const stRenderOptions &opt) {
+	std::cerr << job.input.filename().string() << " #" << (job.track + 1) << ": ";
+	if (!res.ok) {
+		std::cerr << res.error << '\n';
+		return;
+	}
+	double length = static_cast<double>(res.samples) / opt.settings.SampleRate;
+	std::cerr << res.frames << " frames (" << length << " s) in " << res.elapsed << " s, "
+		<< static_cast<std::size_t>(res.samples / res.elapsed) << " samples/s, "
+		<< (length / res.elapsed) << "x realtime\n";
+	if (!res.warning.empty())
+		std::cerr << "  " << res.warning << '\n';
+	std::cerr << res.profile;
+}
+
+// records a timeline for the lifetime of the object and writes it at the end
+class CTraceSession {
+public:
+	explicit CTraceSession(fs::path fname) : fname_(std::move(fname)) {
+		if (!fname_.empty()) {
+			FTEnv.GetTraceRecorder()->SetThreadName("Main");
+			FTEnv.GetTraceRecorder()->Start();
+		}
+	}
+	~CTraceSession() {
+		if (fname_.empty())
+			return;
+		auto *pRecorder = FTEnv.GetTraceRecorder();
+		pRecorder->Stop();
+		CSimpleFile file {fname_, std::ios::out | std::ios::binary};
+		if (!file) {
+			std::cerr << "Could not open trace file\n";
+			return;
+		}
+		pRecorder->Write(file);
+		std::cerr << "Wrote " << pRecorder->GetEventCount() << " trace events";
+		if (std::size_t dropped = pRecorder->GetDroppedCount())
+			std::cerr << ", dropped " << dropped;
+		std::cerr << '\n';
+	}
+
+private:
+	fs::path fname_;
+};
+
+// workers take the next unclaimed job until the queue is exhausted
+bool RenderBatch(const std::vector<stRenderJob> &jobs, const stRenderOptions &opt) {
+	std::vector<stRenderResult> results(jobs.size());
+	std::atomic<std::size_t> next {0u};
+	std::mutex printLock;
+
+	auto worker = [&] (unsigned id) {
+		if (id)
+			FTEnv.GetTraceRecorder()->SetThreadName("Worker " + std::to_string(id));
+		for (std::size_t i; (i = next++) < jobs.size(); ) {
+			results[i] = RenderJob(jobs[i], opt);
+			std::lock_guard<std::mutex> lock {printLock};
+			PrintResult(jobs[i], results[i], opt);
+		}
+	};
+
+	unsigned threads = opt.jobs ? opt.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+	threads = std::min<std::size_t>(threads, jobs.size());
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads; ++i)
+		pool.emplace_back(worker, i);
+	worker(0u);
+	for (auto &t : pool)
+		t.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::size_t samples = 0u;
+	std::size_t failed = 0u;
+	for (const auto &res : results) {
+		samples += res.samples;
+		if (!res.ok)
+			++failed;
+	}
+	double length = static_cast<double>(samples) / opt.settings.SampleRate;
+	std::cerr << "Rendered " << (jobs.size() - failed) << " of " << jobs.size() << " tracks (" << length << " s) in "
+		<< elapsed << " s on " << threads << " threads, " << static_cast<std::size_t>(samples / elapsed) << " samples/s\n";
+
+	return !failed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+	stRenderOptions opt;
+	fs::path outdir;
+
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-m") {
+			opt.settings.ChannelStems = true;
+			continue;
+		}
+		if (arg == "-f") {
+			opt.settings.FloatOutput = true;
+			continue;
+		}
+		if (arg == "-w") {
+			opt.settings.RegisterTrace = true;
+			continue;
+		}
+		if (arg == "-g") {
+			opt.settings.VGMOutput = true;
+			continue;
+		}
+		if (arg == "-P") {
+			opt.settings.Profile = true;
+			continue;
+		}
+		if (arg.size() != 2 || i + 1 >= argc) {
+			PrintUsage();
+			return 1;
+		}
+		if (arg[1] == 'o') {
+			outdir = argv[++i];
+			continue;
+		}
+		if (arg[1] == 'T') {
+			opt.trace = argv[++i];
+			continue;
+		}
+		if (arg[1] == 'd') {
+			opt.sink = argv[++i];
+			if (opt.sink != "null" && opt.sink != "pipe" && opt.sink != "wav") {
+				PrintUsage();
+				return 1;
+			}
+			continue;
+		}
+		if (arg[1] == 'q') {
+			std::string quality = argv[++i];
+			if (quality == "fast")
+				opt.settings.SynthQuality = synth_quality_t::Fast;
+			else if (quality == "good")
+				opt.settings.SynthQuality = synth_quality_t::Good;
+			else if (quality == "high")
+				opt.settings.SynthQuality = synth_quality_t::High;
+			else {
+				PrintUsage();
+				return 1;
+			}
+			continue;
+		}
+		if (arg[1] == 'p') {
+			std::string pan = argv[++i];
+			auto pos = pan.find('=');
+			if (pos == std::string::npos || !pos) {
+				PrintUsage();
+				return 1;
+			}
+			opt.settings.ChannelPans.emplace_back(pan.substr(0, pos), std::stoi(pan.substr(pos + 1)));
+			opt.settings.Channels = 2u;
+			continue;
+		}
+		unsigned val = std::stoul(argv[++i]);
+		switch (arg[1]) {
+		case 't': opt.track = static_cast<int>(val) - 1; break;
+		case 'l': opt.type = render_type_t::Loops; opt.param = val; break;
+		case 's': opt.type = render_type_t::Seconds; opt.param = val; break;
+		case 'r': opt.settings.SampleRate = val; break;
+		case 'b': opt.settings.SampleSize = val; break;
+		case 'j': opt.jobs = val; break;
+		case 'c': opt.settings.Channels = val; break;
+		default:
+			PrintUsage();
+			return 1;
+		}
+	}
+	if ((opt.settings.SampleSize != 8u && opt.settings.SampleSize != 16u) ||
+		(opt.settings.Channels != 1u && opt.settings.Channels != 2u)) {
+		PrintUsage();
+		return 1;
+	}
+
+	CTraceSession traceSession {opt.trace};
+	std::vector<stRenderJob> jobs;
+	if (!opt.sink.empty()) {
+		// the driver's output has no stems, trace or VGM file
+		unsigned outputs = opt.sink == "wav" ? 1u : 0u;
+		if (!outdir.empty() || argc - i != 1 + static_cast<int>(outputs) || IsTrace(argv[i])) {
+			PrintUsage();
+			return 1;
+		}
+		// the driver only converts to 8- or 16-bit PCM
+		if (opt.settings.FloatOutput) {
+			std::cerr << "Float output is not supported with -d\n";
+			return 1;
+		}
+		opt.settings.ChannelStems = opt.settings.RegisterTrace = opt.settings.VGMOutput = false;
+#ifdef _WIN32
+		if (opt.sink == "pipe")
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		jobs.push_back({argv[i], static_cast<unsigned>(std::max(opt.track, 0)), outputs ? argv[i + 1] : ""});
+		auto res = RenderJob(jobs.front(), opt);
+		PrintResult(jobs.front(), res, opt);
+		return res.ok ? 0 : 1;
+	}
+
+	if (outdir.empty()) {
+		if (argc - i != 2) {
+			PrintUsage();
+			return 1;
+		}
+		jobs.push_back({argv[i], static_cast<unsigned>(std::max(opt.track, 0)), argv[i + 1]});
+		auto res = RenderJob(jobs.front(), opt);
+		PrintResult(jobs.front(), res, opt);
+		return res.ok ? 0 : 1;
+	}
+
+	if (argc - i < 1) {
+		PrintUsage();
+		return 1;
+	}
+	fs::create_directories(outdir);
+	for (; i < argc; ++i) {
+		fs::path input = argv[i];
+		if (IsTrace(input)) {
+			jobs.push_back({input, 0u, outdir / (input.stem().string() + ".wav")});
+			continue;
+		}
+		CFamiTrackerModule modfile;
+		LoadModule(modfile, input);
+		unsigned tracks = static_cast<unsigned>(modfile.GetSongCount());
+		for (unsigned t = 0; t < tracks; ++t)
+			if (opt.track < 0 || static_cast<unsigned>(opt.track) == t) {
+				char suffix[16] = { };
+				std::snprintf(suffix, std::size(suffix), "_%02u", t + 1);
+				jobs.push_back({input, t, outdir / (input.stem().string() + suffix + ".wav")});
+			}
+	}
+
+	// inputs with the same name from different folders would overwrite each other
+	std::map<fs::path, const stRenderJob *> outputs;
+	for (const auto &job : jobs)
+		if (auto [it, inserted] = outputs.try_emplace(job.output, &job); !inserted) {
+			std::cerr << job.input.string() << " and " << it->second->input.string() << " would both write "
+				<< job.output.string() << '\n';
+			return 1;
+		}
+
+	return RenderBatch(jobs, opt) ? 0 : 1;
+}
+catch (CModuleException &e) {
+	std::cerr << e.GetErrorString() << '\n';
+	return 1;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	return 1;
+}
@@ -26,6 +26,7 @@
 #include "APU/Mixer.h"
 #include "ft0cc/doc/dpcm_sample.hpp"		// // //
 #include "RegisterState.h"		// // //
+#include "StateArchive.h"		// // //
 
 // // // 2A03 sound chip class
 
@@ -239,6 +240,7 @@ void C2A03::WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample)
 
 void C2A03::ClearSample() {		// // //
 	m_DPCM.GetSampleMemory().Clear();
+	preview_sample_.reset();		// // //
 }
 
 uint8_t C2A03::GetSamplePos() const
@@ -255,3 +257,15 @@ bool C2A03::DPCMPlaying() const
 {
 	return m_DPCM.IsPlaying();
 }
+
+void C2A03::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	ar(m_Square1, m_Square2, m_Triangle, m_Noise, m_DPCM, m_iFrameSequence, m_iFrameMode, preview_sample_);
+	if (ar.IsLoading()) {
+		if (preview_sample_)
+			m_DPCM.GetSampleMemory().SetMem(*preview_sample_);
+		else
+			m_DPCM.GetSampleMemory().Clear();
+	}
+}
@@ -37,7 +37,7 @@ class dpcm_sample;
 #include "APU/Noise.h"
 #include "APU/DPCM.h"
 
-class C2A03 : public CSoundChip
+class C2A03 final : public CSoundChip		// // // final so CAPU calls it directly
 {
 public:
 	C2A03(CMixer &Mixer, std::uint8_t nInstance);
@@ -52,6 +52,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped) override;
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 public:
 	void	ClockSequence();		// // //
@@ -22,7 +22,13 @@
 
 #include "APU/2A03Chan.h"
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 
 uint16_t C2A03Chan::GetPeriod() const {
 	return m_iPeriod;
 }
+
+void C2A03Chan::SerializeState(CStateArchive &ar) {		// // //
+	CChannel::SerializeState(ar);
+	ar(m_iControlReg, m_iEnabled, m_iPeriod, m_iLengthCounter, m_iCounter);
+}
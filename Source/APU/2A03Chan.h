@@ -31,6 +31,8 @@ public:
 
 	uint16_t GetPeriod() const;
 
+	void SerializeState(CStateArchive &ar);		// // //
+
 	static constexpr unsigned SEQUENCER_FREQUENCY = 240;
 
 	static constexpr uint8_t LENGTH_TABLE[] = {
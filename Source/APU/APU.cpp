@@ -28,14 +28,20 @@
 #include "APU/MMC5.h"
 #include "APU/N163.h"
 #include "APU/VRC7.h"
+#include "APU/RegisterListener.h"		// // //
 #include "FamiTrackerEnv.h"		// // //
 #include "SoundChipService.h"		// // //
 #include "RegisterState.h"		// // //
+#include "StateArchive.h"		// // //
 #include "Assertion.h"		// // //
+#include "FrameProfiler.h"		// // //
+#include "TraceRecorder.h"		// // //
 
 CAPU::CAPU(IAudioCallback *pCallback) :		// // //
 	m_pMixer(std::make_unique<CMixer>()),		// // //
 	m_pParent(pCallback),
+	m_pTraceRecorder(FTEnv.GetTraceRecorder()),		// // //
+	m_iMachine(DEFAULT_MACHINE_TYPE),		// // //
 	m_iSampleRate(44100),		// // //
 	m_iCyclesToRun(0),
 	m_iFrameCycles(0),
@@ -48,6 +54,18 @@ CAPU::CAPU(IAudioCallback *pCallback) :		// // //
 		m_pSoundChips.push_back(pSCS->MakeSoundChipDriver(c, *m_pMixer, INSTANCE_ID));
 	});
 
+	// // // the only casts; everything after this uses the typed handles
+	for (auto &c : m_pSoundChips)
+		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
+			m_p2A03 = p2A03;
+		else if (auto *pMMC5 = dynamic_cast<CMMC5 *>(c.get()))
+			m_pMMC5 = pMMC5;
+		else if (auto *pVRC7 = dynamic_cast<CVRC7 *>(c.get()))
+			m_pVRC7 = pVRC7;
+		else if (auto *pN163 = dynamic_cast<CN163 *>(c.get()))
+			m_pN163 = pN163;
+	Assert(m_p2A03 != nullptr);
+
 #ifdef LOGGING
 	m_pLog = std::make_unique<CFile>("apu_log.txt", CFile::modeCreate | CFile::modeWrite);
 	m_iFrame = 0;
@@ -67,12 +85,21 @@ CAPU::~CAPU()
 //
 void CAPU::Process()
 {
+	if (m_iCyclesToRun > 0)		// // //
+		for (auto *l : m_pListeners)
+			l->AddRun(m_iCyclesToRun);
+
+	// // // read once per call, not on every sequencer step
+	const bool Instrumented = m_pProfiler || m_pTraceRecorder->IsRecording();
+
 	while (m_iCyclesToRun > 0) {
 
 		uint32_t Time = std::min(m_iCyclesToRun, m_iSequencerNext - m_iSequencerClock);		// // //
 
-		for (auto *Chip : m_pActiveChips)		// // //
-			Chip->Process(Time);
+		if (Instrumented)		// // //
+			ProcessChipsInstrumented(Time);
+		else
+			ProcessChips(Time);
 
 		m_iFrameCycles	  += Time;
 		m_iSequencerClock += Time;
@@ -89,11 +116,51 @@ void CAPU::StepSequence()		// // //
 		m_iSequencerClock = m_iSequencerCount = 0;
 	m_iSequencerNext = (uint64_t)MASTER_CLOCK_NTSC * (m_iSequencerCount + 1) / C2A03Chan::SEQUENCER_FREQUENCY;
 
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ClockSequence();
-		else if (auto *pMMC5 = dynamic_cast<CMMC5 *>(c.get()))
-			pMMC5->ClockSequence();
+	m_p2A03->ClockSequence();		// // //
+	if (m_pSequencedMMC5)
+		m_pSequencedMMC5->ClockSequence();
+}
+
+void CAPU::ProcessChips(uint32_t Time)		// // //
+{
+	// the 2A03 is always present and its class is final, so this call is direct;
+	// a module without expansion chips never enters the virtual loop
+	m_p2A03->Process(Time);
+	for (auto *Chip : m_pExpansionChips)
+		Chip->Process(Time);
+}
+
+void CAPU::ProcessChipsInstrumented(uint32_t Time)		// // //
+{
+	for (auto *Chip : m_pActiveChips) {
+		CProfileScope scope {m_pProfiler, profile_section_t::ChipProcess, Chip->GetID()};
+		CTraceScope trace {"Chip process", "apu", Chip->GetID()};
+		Chip->Process(Time);
+	}
+}
+
+void CAPU::EndFrameChips()		// // //
+{
+	for (auto *Chip : m_pActiveChips) {
+		CProfileScope scope {m_pProfiler, profile_section_t::ChipEndFrame, Chip->GetID()};
+		Chip->EndFrame();
+	}
+}
+
+void CAPU::FlushBuffer(int SamplesAvail)		// // //
+{
+	CProfileScope scope {m_pProfiler, profile_section_t::AudioFlush};
+
+	if (m_pFloatBuffer) {		// // //
+		int ReadSamples	= m_pMixer->ReadBuffer(SamplesAvail, m_pFloatBuffer.get(), m_bStereoEnabled);
+		if (m_pParent)
+			m_pParent->FlushBuffer(array_view<float> {m_pFloatBuffer.get(), (unsigned)ReadSamples << m_iSampleSizeShift});
+	}
+	else {
+		int ReadSamples	= m_pMixer->ReadBuffer(SamplesAvail, m_pSoundBuffer.get(), m_bStereoEnabled);
+		if (m_pParent)		// // // stereo samples are interleaved
+			m_pParent->FlushBuffer(array_view<int16_t> {m_pSoundBuffer.get(), (unsigned)ReadSamples << m_iSampleSizeShift});
+	}
 }
 
 // End of audio frame, flush the buffer if enough samples has been produced, and start a new frame
@@ -101,19 +168,23 @@ void CAPU::EndFrame()
 {
 	// The APU will always output audio in 32 bit signed format
 
-	for (auto *Chip : m_pActiveChips)		// // //
-		Chip->EndFrame();
+	CTraceScope trace {"APU end of frame", "apu"};		// // //
+	EndFrameChips();		// // //
 
-	int SamplesAvail = m_pMixer->FinishBuffer(m_iFrameCycles);
-	int ReadSamples	= m_pMixer->ReadBuffer(SamplesAvail, m_pSoundBuffer.get(), m_bStereoEnabled);
-	if (m_pParent)		// // //
-		m_pParent->FlushBuffer({m_pSoundBuffer.get(), (unsigned)ReadSamples});
+	int SamplesAvail = [&] {		// // //
+		CProfileScope scope {m_pProfiler, profile_section_t::MixerFinish};
+		return m_pMixer->FinishBuffer(m_iFrameCycles);
+	}();
+	FlushBuffer(SamplesAvail);		// // //
 
 	m_iFrameCycles = 0;
 
 	for (auto *r : m_pActiveChips)		// // //
 		r->GetRegisterLogger().Step();
 
+	for (auto *l : m_pListeners)		// // //
+		l->AddEndFrame();
+
 #ifdef LOGGING
 	++m_iFrame;
 #endif
@@ -131,9 +202,7 @@ void CAPU::Reset()
 	m_iCyclesToRun		= 0;
 	m_iFrameCycles		= 0;
 
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ClearSample();
+	m_p2A03->ClearSample();		// // //
 
 	for (auto *Chip : m_pActiveChips) {		// // //
 		Chip->GetRegisterLogger().Reset();
@@ -142,6 +211,9 @@ void CAPU::Reset()
 
 	m_pMixer->ClearBuffer();
 
+	for (auto *l : m_pListeners)		// // //
+		l->AddReset();
+
 #ifdef LOGGING
 	m_iFrame = 0;
 #endif
@@ -151,9 +223,8 @@ void CAPU::SetupMixer(int LowCut, int HighCut, int HighDamp, int Volume) const
 {
 	// New settings
 	m_pMixer->UpdateSettings(LowCut, HighCut, HighDamp, float(Volume) / 100.0f);
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *pVRC7 = dynamic_cast<CVRC7 *>(c.get()))
-			pVRC7->SetVolume((float(Volume) / 100.0f) * m_fLevelVRC7);
+	if (m_pVRC7)		// // //
+		m_pVRC7->SetVolume((float(Volume) / 100.0f) * m_fLevelVRC7);
 }
 
 // // //
@@ -161,16 +232,27 @@ void CAPU::SetCallback(IAudioCallback &pCallback) {
 	m_pParent = &pCallback;
 }
 
+void CAPU::SetProfiler(CFrameProfiler *pProfiler) {		// // //
+	m_pProfiler = pProfiler;
+}
+
 void CAPU::SetExternalSound(CSoundChipSet Chip) {
 	// Set expansion chip
 	m_iExternalSoundChip = Chip;
+	for (auto *l : m_pListeners)		// // //
+		l->AddChips(Chip);
 	m_pMixer->ExternalSound(Chip);
 
 	m_pActiveChips.clear();
+	m_pExpansionChips.clear();		// // //
 
 	for (auto &c : m_pSoundChips)		// // //
-		if (Chip.ContainsChip(c->GetID()))
+		if (Chip.ContainsChip(c->GetID())) {
 			m_pActiveChips.push_back(c.get());
+			if (c.get() != m_p2A03)
+				m_pExpansionChips.push_back(c.get());
+		}
+	m_pSequencedMMC5 = Chip.ContainsChip(sound_chip_t::MMC5) ? m_pMMC5 : nullptr;		// // //
 
 	Reset();
 }
@@ -180,15 +262,17 @@ void CAPU::ChangeMachineRate(machine_t Machine, int Rate)		// // //
 	// Allow to change speed on the fly
 	//
 
+	m_iMachine = Machine;		// // //
+	for (auto *l : m_pListeners)
+		l->AddMachine(Machine);
+
 	uint32_t BaseFreq = (Machine == machine_t::NTSC) ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ChangeMachine(Machine);
-		else if (auto *pVRC7 = dynamic_cast<CVRC7 *>(c.get()))
-			pVRC7->SetSampleSpeed(m_iSampleRate, BaseFreq, Rate);
+	m_p2A03->ChangeMachine(Machine);		// // //
+	if (m_pVRC7)
+		m_pVRC7->SetClockRate(BaseFreq);		// // //
 }
 
-bool CAPU::SetupSound(int SampleRate, int NrChannels, machine_t Machine)		// // //
+bool CAPU::SetupSound(int SampleRate, int NrChannels, machine_t Machine, bool FloatOutput)		// // //
 {
 	// Allocate a sound buffer
 	//
@@ -207,12 +291,18 @@ bool CAPU::SetupSound(int SampleRate, int NrChannels, machine_t Machine)		// //
 
 	if (!m_pMixer->AllocateBuffer(m_iSoundBufferSamples, m_iSampleRate, NrChannels))		// // //
 		return false;
+	if (m_pVRC7)		// // //
+		m_pVRC7->SetStereo(m_pMixer->IsStereo());
 
 	m_pMixer->SetClockRate(BaseFreq);
 
 	m_pSoundBuffer = std::make_unique<int16_t[]>(m_iSoundBufferSize << 1);
 	if (!m_pSoundBuffer)
 		return false;
+	if (FloatOutput)		// // //
+		m_pFloatBuffer = std::make_unique<float[]>(m_iSoundBufferSize << 1);
+	else
+		m_pFloatBuffer.reset();
 
 	ChangeMachineRate(Machine, FrameRate);		// // //
 
@@ -236,6 +326,39 @@ void CAPU::Write(uint16_t Address, uint8_t Value)
 		Chip->Write(Address, Value);
 
 	LogWrite(Address, Value);
+	for (auto *l : m_pListeners)		// // //
+		l->AddWrite(Address, Value);
+}
+
+void CAPU::WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample)		// // //
+{
+	for (auto *l : m_pListeners)
+		l->AddSample(pSample);
+	m_p2A03->WriteSample(std::move(pSample));		// // //
+}
+
+// // // the current machine and chips are sent first, so that a listener attached
+// before the APU is set up sees it from its initial state
+void CAPU::AddListener(CRegisterListener &Listener)
+{
+	if (std::find(m_pListeners.begin(), m_pListeners.end(), &Listener) != m_pListeners.end())
+		return;
+	m_pListeners.push_back(&Listener);
+	Listener.AddMachine(m_iMachine);
+	Listener.AddChips(m_iExternalSoundChip);
+}
+
+void CAPU::RemoveListener(CRegisterListener &Listener)
+{
+	m_pListeners.erase(std::remove(m_pListeners.begin(), m_pListeners.end(), &Listener), m_pListeners.end());
+}
+
+void CAPU::SerializeState(CStateArchive &ar)		// // //
+{
+	ar(m_iCyclesToRun, m_iFrameCycles, m_iSequencerClock, m_iSequencerNext, m_iSequencerCount);
+	for (auto *Chip : m_pActiveChips)
+		Chip->SerializeState(ar);
+	m_pMixer->SerializeState(ar);
 }
 
 uint8_t CAPU::Read(uint16_t Address)
@@ -247,6 +370,8 @@ uint8_t CAPU::Read(uint16_t Address)
 	bool Mapped(false);
 
 	Process();
+	for (auto *l : m_pListeners)		// // //
+		l->AddRead(Address);
 
 	for (auto *Chip : m_pActiveChips)		// // //
 		if (!Mapped)
@@ -329,12 +454,44 @@ void CAPU::SetChipLevel(chip_level_t Chip, float Level)
 	}
 }
 
+void CAPU::SetChannelPan(stChannelID Channel, float Pan)		// // //
+{
+	m_pMixer->SetChannelPan(Channel, Pan);
+	if (m_pVRC7 && Channel.Chip == sound_chip_t::VRC7) {		// // // the VRC7 pans its own output
+		double Left, Right;
+		m_pMixer->GetPanGains(Channel, Left, Right);
+		m_pVRC7->SetChannelPan(Channel.Subindex, Left, Right);
+	}
+}
+
+void CAPU::SetSynthQuality(synth_quality_t Quality)		// // //
+{
+	m_pMixer->SetSynthQuality(Quality);
+}
+
 void CAPU::SetNamcoMixing(bool bLinear)		// // //
 {
 	m_pMixer->SetNamcoMixing(bLinear);
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *pN163 = dynamic_cast<CN163 *>(c.get()))
-			pN163->SetMixingMethod(bLinear);
+	if (m_pN163)		// // //
+		m_pN163->SetMixingMethod(bLinear);
+}
+
+void CAPU::SetStemChannels(const std::vector<stChannelID> &Channels)		// // //
+{
+	m_pMixer->SetStemChannels(Channels);
+	if (m_pVRC7)		// // //
+		m_pVRC7->SetStemChannels(Channels);
+}
+
+int CAPU::ReadStemBuffer(stChannelID Chan, int16_t *pBuffer, int Size)		// // //
+{
+	// call from IAudioCallback::FlushBuffer, stems contain the same number of samples as the main buffer
+	return m_pMixer->ReadStem(Chan, Size, pBuffer);
+}
+
+int CAPU::ReadStemBuffer(stChannelID Chan, float *pBuffer, int Size)		// // //
+{
+	return m_pMixer->ReadStem(Chan, Size, pBuffer);
 }
 
 void CAPU::SetMeterDecayRate(decay_rate_t Type) const		// // // 050B
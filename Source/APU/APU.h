@@ -36,7 +36,15 @@ class dpcm_sample;
 } // namespace ft0cc::doc
 class CMixer;		// // //
 class CSoundChip;		// // //
+class C2A03;		// // //
+class CMMC5;		// // //
+class CVRC7;		// // //
+class CN163;		// // //
 class CRegisterState;		// // //
+class CRegisterListener;		// // //
+class CStateArchive;		// // //
+class CFrameProfiler;		// // //
+class CTraceRecorder;		// // //
 enum chip_level_t : unsigned char;		// // //
 
 #ifdef LOGGING
@@ -45,6 +53,10 @@ class CFile;
 
 class CAPU : public CAPUInterface {
 public:
+	// // // longest frame that the sample buffer holds at every sample rate, it is
+	// sized for two PAL frames
+	static constexpr uint32_t MAX_FRAME_CYCLES = MASTER_CLOCK_PAL / FRAME_RATE_PAL * 3 / 2;
+
 	explicit CAPU(IAudioCallback *pCallback = nullptr);		// // //
 	~CAPU();
 
@@ -55,12 +67,17 @@ public:
 
 	void	SetExternalSound(CSoundChipSet Chips);
 	void	Write(uint16_t Address, uint8_t Value) override;		// // //
+	void	WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample) override;		// // //
 	uint8_t	Read(uint16_t Address);
 
+	void	AddListener(CRegisterListener &Listener);		// // // sees every call that changes the chips' state
+	void	RemoveListener(CRegisterListener &Listener);
+
 	void	ChangeMachineRate(machine_t Machine, int Rate);		// // //
-	bool	SetupSound(int SampleRate, int NrChannels, machine_t Speed);		// // //
+	bool	SetupSound(int SampleRate, int NrChannels, machine_t Speed, bool FloatOutput = false);		// // //
 	void	SetupMixer(int LowCut, int HighCut, int HighDamp, int Volume) const;
 	void	SetCallback(IAudioCallback &pCallback);		// // //
+	void	SetProfiler(CFrameProfiler *pProfiler);		// // // nullptr disables profiling
 
 	int32_t	GetVol(stChannelID Chan) const;		// // //
 	uint8_t	GetReg(sound_chip_t Chip, int Reg) const;
@@ -70,30 +87,56 @@ public:
 	void	SetChipLevel(chip_level_t Chip, float Level);
 
 	void	SetNamcoMixing(bool bLinear);		// // //
+	void	SetChannelPan(stChannelID Channel, float Pan);		// // // -1 to 1, only heard in stereo
+	void	SetSynthQuality(synth_quality_t Quality);		// // //
+
+	void	SetStemChannels(const std::vector<stChannelID> &Channels);		// // //
+	int		ReadStemBuffer(stChannelID Chan, int16_t *pBuffer, int Size);		// // //
+	int		ReadStemBuffer(stChannelID Chan, float *pBuffer, int Size);		// // //
 
 	void	SetMeterDecayRate(decay_rate_t Type) const;		// // // 050B
 	decay_rate_t GetMeterDecayRate() const;		// // // 050B
 
 	CSoundChip *GetSoundChip(sound_chip_t Chip) const override;		// // //
 
+	// // // state of the active chips and the mixer, taken or restored between frames;
+	// restoring does not notify the listeners
+	void	SerializeState(CStateArchive &ar);
+
 #ifdef LOGGING
 	void	Log();
 #endif
 
 private:
 	void StepSequence();		// // //
+	void ProcessChips(uint32_t Time);		// // //
+	void ProcessChipsInstrumented(uint32_t Time);		// // //
+	void EndFrameChips();		// // //
+	void FlushBuffer(int SamplesAvail);		// // //
 
 	void LogWrite(uint16_t Address, uint8_t Value);
 
 private:
 	std::unique_ptr<CMixer> m_pMixer;		// // //
 	IAudioCallback *m_pParent;
+	CFrameProfiler *m_pProfiler = nullptr;		// // //
+	CTraceRecorder *m_pTraceRecorder;		// // // FTEnv's, looked up once
 
 	// Expansion chips
 	std::vector<std::unique_ptr<CSoundChip>> m_pSoundChips;		// // //
 	std::vector<CSoundChip *> m_pActiveChips;		// // //
+	std::vector<CSoundChip *> m_pExpansionChips;	// // // active chips other than the 2A03
+
+	// // // typed handles, resolved once when the chips are created
+	C2A03 *m_p2A03 = nullptr;
+	CMMC5 *m_pMMC5 = nullptr;
+	CVRC7 *m_pVRC7 = nullptr;
+	CN163 *m_pN163 = nullptr;
+	CMMC5 *m_pSequencedMMC5 = nullptr;				// // // MMC5 if active, clocked by the frame sequencer
 
 	CSoundChipSet m_iExternalSoundChip;				// // // External sound chip, if used
+	machine_t	m_iMachine;							// // //
+	std::vector<CRegisterListener *> m_pListeners;	// // //
 
 	uint32_t	m_iSampleRate;						// // //
 	uint32_t	m_iFrameClock;
@@ -106,6 +149,7 @@ private:
 	uint32_t	m_iSoundBufferSize;					// Size of buffer, in samples
 	uint32_t	m_iBufferPointer;					// Fill pos in buffer
 	std::unique_ptr<int16_t[]> m_pSoundBuffer;			// // // Sound transfer buffer
+	std::unique_ptr<float[]> m_pFloatBuffer;			// // // Sound transfer buffer for float output
 
 	uint32_t	m_iFrameCycles;						// Cycles emulated from start of frame
 	uint32_t	m_iSequencerClock;					// Clock for frame sequencer
@@ -24,8 +24,12 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>		// // //
 #include "APU/Types_fwd.h"
 
+namespace ft0cc::doc {
+class dpcm_sample;
+} // namespace ft0cc::doc
 class CSoundChip;
 
 class CAPUInterface {
@@ -35,4 +39,5 @@ public:
 	virtual CSoundChip *GetSoundChip(sound_chip_t Chip) const = 0;
 
 	virtual void Write(uint16_t Address, uint8_t Value) = 0;
+	virtual void WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample) = 0;		// // // loads the 2A03's sample memory
 };
@@ -22,6 +22,7 @@
 
 #include "APU/Channel.h"
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 
 CChannel::CChannel(CMixer &Mixer, stChannelID ID) :
 	m_pMixer(&Mixer), m_iChanId(ID)
@@ -36,6 +37,10 @@ stChannelID CChannel::GetChannelType() const {		// // //
 	return m_iChanId;
 }
 
+void CChannel::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_iTime, m_iLastValue);
+}
+
 void CChannel::Mix(int32_t Value) {
 	if (Value != m_iLastValue) {
 		m_pMixer->AddValue(m_iChanId, Value - m_iLastValue, m_iTime);
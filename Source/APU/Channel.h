@@ -27,6 +27,7 @@
 #include "APU/Types.h"		// // //
 
 class CMixer;
+class CStateArchive;		// // //
 
 //
 // This class is used to derive the audio channels
@@ -43,6 +44,8 @@ public:
 
 	virtual double GetFrequency() const = 0;		// // //
 
+	void SerializeState(CStateArchive &ar);		// // // derived channels call this first
+
 protected:
 	void Mix(int32_t Value);		// // //
 
@@ -22,6 +22,7 @@
 
 #include "APU/DPCM.h"
 #include "APU/Types.h"		// // //
+#include "StateArchive.h"		// // //
 
 const uint16_t CDPCM::DMC_PERIODS_NTSC[16] = {
 	428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
@@ -188,3 +189,11 @@ double CDPCM::GetFrequency() const		// // //
 	double Rate = PERIOD_TABLE == DMC_PERIODS_PAL ? MASTER_CLOCK_PAL : MASTER_CLOCK_NTSC;
 	return Rate / m_iPeriod;
 }
+
+void CDPCM::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iBitDivider, m_iShiftReg, m_iPlayMode, m_iDeltaCounter, m_iSampleBuffer,
+		m_iDMA_LoadReg, m_iDMA_LengthReg, m_iDMA_Address, m_iDMA_BytesRemaining,
+		m_bTriggeredIRQ, m_bSampleFilled, m_bSilenceFlag);
+}
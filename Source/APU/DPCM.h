@@ -37,6 +37,7 @@ public:
 	uint8_t	ReadControl() const;
 	void	Process(uint32_t Time);
 	double	GetFrequency() const;		// // //
+	void	SerializeState(CStateArchive &ar);		// // // the sample memory is mapped by C2A03
 
 	uint8_t	DidIRQ() const;
 	void	Reload();
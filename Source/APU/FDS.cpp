@@ -24,6 +24,7 @@
 #include "RegisterState.h"		// // //
 #include "APU/ext/FDSSound_new.h"		// // //
 #include "APU/Types.h"		// // //
+#include "StateArchive.h"		// // //
 
 // FDS interface, actual FDS emulation is in FDSSound.cpp
 
@@ -78,6 +79,13 @@ void CFDS::Process(uint32_t Time)
 		Mix(emu_->Render());
 		m_iTime += t;
 		Time -= t;
+
+		// // // jump over steps that would produce the same output
+		if (t == TIME_STEP) {
+			const uint32_t Skip = emu_->SkipIdle(TIME_STEP, Time / TIME_STEP) * TIME_STEP;
+			m_iTime += Skip;
+			Time -= Skip;
+		}
 	}
 }
 
@@ -91,3 +99,10 @@ double CFDS::GetFreq(int Channel) const		// // //
 	Lo |= (Hi << 8) & 0xF00;
 	return MASTER_CLOCK_NTSC * (Lo / 4194304.);
 }
+
+void CFDS::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	CChannel::SerializeState(ar);
+	emu_->SerializeState(ar);
+}
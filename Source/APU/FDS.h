@@ -47,6 +47,8 @@ public:
 	double	GetFreq(int Channel) const override;		// // //
 	double	GetFrequency() const { return GetFreq(0); }		// // //
 
+	void	SerializeState(CStateArchive &ar) override;		// // //
+
 private:
 	std::unique_ptr<xgm::NES_FDS> emu_;		// // //
 };
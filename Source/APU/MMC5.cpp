@@ -23,6 +23,7 @@
 #include "APU/MMC5.h"
 #include "APU/Types.h"
 #include "RegisterState.h"		// // //
+#include "StateArchive.h"		// // //
 
 // MMC5 external sound
 
@@ -151,3 +152,9 @@ void CMMC5::ClockSequence()
 	EnvelopeUpdate();		// // //
 	LengthCounterUpdate();		// // //
 }
+
+void CMMC5::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	ar(m_Square1, m_Square2, m_iEXRAM, m_iMulLow, m_iMulHigh);
+}
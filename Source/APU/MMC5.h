@@ -40,6 +40,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped) override;
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 	void LengthCounterUpdate();
 	void EnvelopeUpdate();
@@ -53,16 +53,23 @@
 */
 
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 #include <algorithm>		// // //
 #include <memory>
 #include <cmath>
-#include "APU/ext/emu2413.h"		// // //
+#include <type_traits>		// // //
 
 namespace {
 
 const float LEVEL_FALL_OFF_RATE = 0.6f;
 const int   LEVEL_FALL_OFF_DELAY = 3;
 
+// // // low-pass filters at higher sample rates have the same response in Hz as at this rate
+const long  FILTER_REFERENCE_RATE = 48000;
+
+// // // rates above the reference that are multiples of these are rendered at them
+const uint32_t OVERSAMPLING_BASE_RATES[] = {48000, 44100};
+
 constexpr chip_level_t GetMixerFromChannel(stChannelID ch) noexcept {		// // //
 	switch (ch.Chip) {
 	case sound_chip_t::APU:
@@ -84,6 +91,59 @@ constexpr chip_level_t GetMixerFromChannel(stChannelID ch) noexcept {		// // //
 	}
 }
 
+// // // N163 channels are numbered in reverse by the emulation
+constexpr std::uint8_t GetMixerSubindex(stChannelID ch) noexcept {
+	if (ch.Chip == sound_chip_t::N163)
+		return static_cast<std::uint8_t>(enum_count<n163_subindex_t>() - 1 - ch.Subindex);
+	return ch.Subindex;
+}
+
+constexpr std::size_t GetChipChannelCount(sound_chip_t chip) noexcept {		// // //
+	switch (chip) {
+	case sound_chip_t::APU:  return MAX_CHANNELS_2A03;
+	case sound_chip_t::VRC6: return MAX_CHANNELS_VRC6;
+	case sound_chip_t::VRC7: return MAX_CHANNELS_VRC7;
+	case sound_chip_t::FDS:  return MAX_CHANNELS_FDS;
+	case sound_chip_t::MMC5: return MAX_CHANNELS_MMC5;
+	case sound_chip_t::N163: return MAX_CHANNELS_N163;
+	case sound_chip_t::S5B:  return MAX_CHANNELS_S5B;
+	default: return 0u;
+	}
+}
+
+// // // balance law, a centered channel keeps its full level on both sides so that
+// stereo output with no panning matches the mono output
+void CalcPanGains(float Pan, double &Left, double &Right) {
+	Left = std::min(1., 1. - Pan);
+	Right = std::min(1., 1. + Pan);
+}
+
+// // // converts the peak level of a frame to the meter scale
+double ScaleChannelLevel(stChannelID Channel, int Peak) {
+	double AbsVol = Peak;
+
+	// Adjust channel levels for some channels
+	if (IsDPCM(Channel))
+		AbsVol /= 8.;
+
+	if (IsVRC6Sawtooth(Channel))
+		AbsVol = AbsVol * .75;
+
+	if (Channel.Chip == sound_chip_t::FDS)
+		AbsVol /= 188.;
+
+	if (Channel.Chip == sound_chip_t::N163)		// // //
+		AbsVol /= 15.;
+
+	if (Channel.Chip == sound_chip_t::VRC7)		// // //
+		AbsVol = std::log(AbsVol) * 3.;
+
+	if (Channel.Chip == sound_chip_t::S5B)		// // //
+		AbsVol = std::log(AbsVol) * 2.8;
+
+	return AbsVol;
+}
+
 } // namespace
 
 template <typename F>
@@ -113,11 +173,38 @@ void CMixer::VisitMixers(F f) {
 	WithMixer(CHIP_LEVEL_S5B, f);
 }
 
+template <typename F>
+void CMixer::WithSynthQuality(F f) const {		// // //
+	switch (m_iSynthQuality) {
+	case synth_quality_t::Fast: f(std::integral_constant<synth_quality_t, synth_quality_t::Fast> { }); break;
+	case synth_quality_t::Good: f(std::integral_constant<synth_quality_t, synth_quality_t::Good> { }); break;
+	case synth_quality_t::High: f(std::integral_constant<synth_quality_t, synth_quality_t::High> { }); break;
+	}
+}
+
 void CMixer::ExternalSound(CSoundChipSet Chip) {		// // //
 	m_iExternalChip = Chip;
+	MapChannelLevels(Chip);		// // //
 	UpdateSettings(m_iLowCut, m_iHighCut, m_iHighDamp, m_fOverallVol);
 }
 
+void CMixer::MapChannelLevels(CSoundChipSet Chips)		// // //
+{
+	m_iTrackLevelCount = 0u;
+	for (auto &x : m_iTrackLevelIndex)
+		x.fill(NO_TRACK_LEVEL);
+
+	for (std::size_t c = 0; c < SOUND_CHIP_COUNT; ++c) {
+		auto chip = enum_cast<sound_chip_t>(static_cast<std::uint8_t>(c));
+		if (!Chips.ContainsChip(chip))
+			continue;
+		for (std::size_t i = 0, n = GetChipChannelCount(chip); i < n; ++i) {
+			m_iTrackLevelIndex[c][i] = static_cast<std::uint8_t>(m_iTrackLevelCount);
+			m_ChannelLevels[m_iTrackLevelCount++] = stTrackLevel {stChannelID {chip, static_cast<std::uint8_t>(i)}};
+		}
+	}
+}
+
 void CMixer::SetNamcoMixing(bool bLinear)		// // //
 {
 	m_bNamcoMixing = bLinear;
@@ -128,6 +215,8 @@ void CMixer::SetChipLevel(chip_level_t Chip, float Level)
 	WithMixer(Chip, [&] (auto &mixer) {
 		mixer.SetMixerLevel(Level);
 	});
+	if (Chip == CHIP_LEVEL_N163)		// // // the N163 does not resend its volume every time
+		ApplyNamcoVolume();
 }
 
 float CMixer::GetAttenuation() const
@@ -171,37 +260,62 @@ void CMixer::UpdateSettings(int LowCut,	int HighCut, int HighDamp, float Overall
 
 	// Blip-buffer filtering
 	BlipBuffer.bass_freq(m_iLowCut);
+	if (m_bStereo)		// // //
+		BlipBufferRight.bass_freq(m_iLowCut);
+	for (auto &x : m_StemBuffers)		// // //
+		x.second->bass_freq(m_iLowCut);
 
-	blip_eq_t eq(-m_iHighDamp, m_iHighCut, m_iSampleRate);
+	blip_eq_t eq(-m_iHighDamp, m_iHighCut, m_iSampleRate, 0, FILTER_REFERENCE_RATE);		// // //
 
 	levels2A03SS_.SetLowPass(eq);
 	levels2A03TND_.SetLowPass(eq);
 	levelsVRC6_.SetLowPass(eq);
 	levelsMMC5_.SetLowPass(eq);
 	levelsS5B_.SetLowPass(eq);
+	levelsVRC7_.SetLowPass(eq);		// // //
 
 	// // // N163 special filtering
-	levelsN163_.SetLowPass({-(double)std::max(24, m_iHighDamp), std::min(m_iHighCut, 12000), (long)m_iSampleRate});
+	levelsN163_.SetLowPass({-(double)std::max(24, m_iHighDamp), std::min(m_iHighCut, 12000), (long)m_iSampleRate, 0, FILTER_REFERENCE_RATE});
 
-	// FDS special filtering (TODO fix this for high sample rates)
-	levelsFDS_.SetLowPass({-48, 1000, (long)m_iSampleRate});
+	// FDS special filtering
+	levelsFDS_.SetLowPass({-48, 1000, (long)m_iSampleRate, 0, FILTER_REFERENCE_RATE});		// // //
 
 	float Volume = m_fOverallVol * GetAttenuation();
 	VisitMixers([&] (auto &levels) {
 		levels.SetVolume(Volume);
 	});
+	ApplyNamcoVolume();		// // //
+	levelsVRC7_.SetVolume(1.);		// // // CVRC7 applies its own volume
 }
 
 void CMixer::SetNamcoVolume(float fVol)
 {
-	float fVolume = fVol * m_fOverallVol * GetAttenuation();
+	m_fNamcoVolume = fVol;		// // //
+	ApplyNamcoVolume();
+}
+
+void CMixer::ApplyNamcoVolume()		// // //
+{
+	if (m_fNamcoVolume == 0.f)
+		return;
+
+	float fVolume = m_fNamcoVolume * m_fOverallVol * GetAttenuation();
 
 	levelsN163_.SetVolume(fVolume);
 }
 
 void CMixer::UpdateMeters() {		// // //
-	for (auto &x : m_ChannelLevels) {
-		auto &lv = x.second;
+	for (std::size_t i = 0; i < m_iTrackLevelCount; ++i) {
+		auto &lv = m_ChannelLevels[i];
+		if (lv.Peak >= 0) {		// // // scale once per frame
+			double AbsVol = ScaleChannelLevel(lv.Channel, lv.Peak);
+			if (AbsVol >= lv.Level) {
+				lv.Level = (float)AbsVol;
+				lv.FallOff = LEVEL_FALL_OFF_DELAY;
+			}
+			lv.Peak = -1;
+		}
+
 		lv.LastLevel = lv.Level;		// // //
 		if (m_iMeterDecayRate == decay_rate_t::Fast)		// // // 050B
 			lv.Level = 0;
@@ -226,32 +340,61 @@ void CMixer::SetMeterDecayRate(decay_rate_t Rate)		// // // 050B
 	m_iMeterDecayRate = Rate;
 }
 
-void CMixer::MixSamples(blip_sample_t *pBuffer, uint32_t Count)
-{
-	// For VRC7
-	BlipBuffer.mix_samples(pBuffer, Count);
-}
-
-uint32_t CMixer::GetMixSampleCount(int t) const
-{
-	return BlipBuffer.count_samples(t);
-}
-
 bool CMixer::AllocateBuffer(unsigned int BufferLength, uint32_t SampleRate, uint8_t NrChannels)
 {
-	m_iSampleRate = SampleRate;
-	return !BlipBuffer.set_sample_rate(SampleRate, (BufferLength * 1000 * 4) / SampleRate);		// // //
+	// // // synthesis rate
+	m_iOversampling = 1u;
+	if (SampleRate > FILTER_REFERENCE_RATE)
+		for (uint32_t Base : OVERSAMPLING_BASE_RATES)
+			if (SampleRate % Base == 0) {
+				m_iOversampling = SampleRate / Base;
+				break;
+			}
+	m_Upsampler.SetFactor(m_iOversampling);
+	m_UpsamplerRight.SetFactor(m_iOversampling);
+	for (auto &x : m_StemUpsamplers)
+		x.second.SetFactor(m_iOversampling);
+
+	m_iSampleRate = SampleRate / m_iOversampling;
+	if (BlipBuffer.set_sample_rate(m_iSampleRate, (BufferLength * 1000 * 4) / SampleRate))		// // //
+		return false;
+
+	// // // the right side reuses every synth, so the chips are only emulated once
+	m_bStereo = NrChannels == 2;
+	if (m_bStereo) {
+		if (BlipBufferRight.set_sample_rate(m_iSampleRate, (BufferLength * 1000 * 4) / SampleRate))
+			return false;
+		BlipBufferRight.bass_freq(m_iLowCut);
+	}
+	VisitMixers([&] (auto &mixer) {
+		mixer.SetRightBuffer(m_bStereo ? &BlipBufferRight : nullptr);
+	});
+	for (auto &x : m_StemBuffers)		// // //
+		SetupStemBuffer(*x.second);
+	return true;
 }
 
 void CMixer::SetClockRate(uint32_t Rate)
 {
 	// Change the clockrate
 	BlipBuffer.clock_rate(Rate);
+	if (m_bStereo)		// // //
+		BlipBufferRight.clock_rate(Rate);
+	for (auto &x : m_StemBuffers)		// // //
+		x.second->clock_rate(Rate);
 }
 
 void CMixer::ClearBuffer()
 {
 	BlipBuffer.clear();
+	if (m_bStereo)		// // //
+		BlipBufferRight.clear();
+	for (auto &x : m_StemBuffers)		// // //
+		x.second->clear();
+	m_Upsampler.Clear();		// // //
+	m_UpsamplerRight.Clear();
+	for (auto &x : m_StemUpsamplers)
+		x.second.Clear();
 	VisitMixers([] (auto &levels) {
 		levels.ResetDelta();
 	});
@@ -259,21 +402,21 @@ void CMixer::ClearBuffer()
 
 int CMixer::SamplesAvail() const
 {
-	return (int)BlipBuffer.samples_avail();
+	return (int)BlipBuffer.samples_avail() * m_iOversampling;		// // //
 }
 
 int CMixer::FinishBuffer(int t)
 {
 	BlipBuffer.end_frame(t);
-
-	// Get channel levels for VRC7
-	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)
-		StoreChannelLevel(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)}, OPLL_getchanvol(i));
+	if (m_bStereo)		// // //
+		BlipBufferRight.end_frame(t);
+	for (auto &x : m_StemBuffers)		// // //
+		x.second->end_frame(t);
 
 	UpdateMeters();		// // //
 
 	// Return number of samples available
-	return BlipBuffer.samples_avail();
+	return BlipBuffer.samples_avail() * m_iOversampling;		// // //
 }
 
 //
@@ -281,52 +424,213 @@ int CMixer::FinishBuffer(int t)
 //
 
 void CMixer::AddValue(stChannelID ChanID, int Value, int FrameCycles) {		// // //
-	WithMixer(GetMixerFromChannel(ChanID), [&] (auto &mixer) {
-		StoreChannelLevel(ChanID, mixer.AddValue(ChanID, Value, FrameCycles, BlipBuffer));
+	WithSynthQuality([&] (auto Q) {
+		WithMixer(GetMixerFromChannel(ChanID), [&] (auto &mixer) {
+			StoreChannelLevel(ChanID, mixer.template AddValue<Q>(ChanID, Value, FrameCycles, BlipBuffer));
+		});
 	});
 }
 
-int CMixer::ReadBuffer(int Size, void *Buffer, bool Stereo)
+void CMixer::AddVRC7Value(int Left, int Right, int FrameCycles)		// // //
 {
-	return BlipBuffer.read_samples((blip_sample_t*)Buffer, Size);
+	// meters are fed by the chip itself once per frame
+	WithSynthQuality([&] (auto Q) {
+		if (Left)
+			levelsVRC7_.AddDelta<Q>(Left, FrameCycles, BlipBuffer);
+		if (m_bStereo && Right)
+			levelsVRC7_.AddDelta<Q>(Right, FrameCycles, BlipBufferRight);
+	});
+}
+
+void CMixer::AddValues(stChannelID Chan1, int Value1, stChannelID Chan2, int Value2, int FrameCycles)		// // //
+{
+	// both channels must belong to the same mixer; the output moves only once
+	WithSynthQuality([&] (auto Q) {
+		WithMixer(GetMixerFromChannel(Chan1), [&] (auto &mixer) {
+			StoreChannelLevel(Chan1, mixer.template OffsetLevel<Q>(Chan1, Value1, FrameCycles));
+			StoreChannelLevel(Chan2, mixer.template OffsetLevel<Q>(Chan2, Value2, FrameCycles));
+			mixer.template UpdateOutput<Q>(FrameCycles, BlipBuffer);
+		});
+	});
+}
+
+int CMixer::ReadBuffer(int Size, blip_sample_t *Buffer, bool Stereo)		// // //
+{
+	return ReadBufferImpl(Size, Buffer, Stereo);
+}
+
+int CMixer::ReadBuffer(int Size, float *Buffer, bool Stereo)		// // //
+{
+	return ReadBufferImpl(Size, Buffer, Stereo);
+}
+
+template <typename T>
+int CMixer::ReadBufferImpl(int Size, T *Buffer, bool Stereo)		// // //
+{
+	if (m_iOversampling > 1u) {
+		if (Stereo && m_bStereo) {
+			int Count = ReadUpsampled(BlipBuffer, m_Upsampler, Size, Buffer, 2);
+			ReadUpsampled(BlipBufferRight, m_UpsamplerRight, Size, Buffer + 1, 2);
+			return Count;
+		}
+		return ReadUpsampled(BlipBuffer, m_Upsampler, Size, Buffer, 1);
+	}
+
+	if (Stereo && m_bStereo) {		// // // interleaved, both sides always hold the same number of samples
+		int Count = BlipBuffer.read_samples(Buffer, Size, 1);
+		BlipBufferRight.read_samples(Buffer + 1, Size, 1);
+		return Count;
+	}
+	return BlipBuffer.read_samples(Buffer, Size);
+}
+
+void CMixer::SetSynthQuality(synth_quality_t Quality)		// // //
+{
+	m_iSynthQuality = Quality;
+	VisitMixers([&] (auto &mixer) {
+		mixer.SetQuality(Quality);
+	});
+	levelsVRC7_.SetQuality(Quality);
+}
+
+bool CMixer::IsStereo() const		// // //
+{
+	return m_bStereo;
+}
+
+void CMixer::SetChannelPan(stChannelID Channel, float Pan)		// // //
+{
+	Pan = std::clamp(Pan, -1.f, 1.f);
+	m_ChannelPan[Channel] = Pan;
+
+	double Left, Right;
+	CalcPanGains(Pan, Left, Right);
+	WithMixer(GetMixerFromChannel(Channel), [&] (auto &mixer) {
+		mixer.SetPan(GetMixerSubindex(Channel), Left, Right);
+	});
+}
+
+void CMixer::GetPanGains(stChannelID Channel, double &Left, double &Right) const		// // //
+{
+	auto it = m_ChannelPan.find(Channel);
+	CalcPanGains(it != m_ChannelPan.end() ? it->second : 0.f, Left, Right);
 }
 
 int32_t CMixer::GetChanOutput(stChannelID Chan) const		// // //
 {
-	auto it = m_ChannelLevels.find(Chan);
-	return it != m_ChannelLevels.end() ? it->second.LastLevel : 0;
+	if (value_cast(Chan.Chip) >= SOUND_CHIP_COUNT || Chan.Subindex >= MAX_CHANNELS_N163)
+		return 0;
+	std::uint8_t Index = m_iTrackLevelIndex[value_cast(Chan.Chip)][Chan.Subindex];
+	return Index < m_iTrackLevelCount ? m_ChannelLevels[Index].LastLevel : 0;
 }
 
 void CMixer::StoreChannelLevel(stChannelID Channel, int Level)		// // //
 {
-	double AbsVol = std::abs(Level);
+	// only the peak is kept here, scaling is done in UpdateMeters
+	if (value_cast(Channel.Chip) >= SOUND_CHIP_COUNT || Channel.Subindex >= MAX_CHANNELS_N163)
+		return;
+	std::uint8_t Index = m_iTrackLevelIndex[value_cast(Channel.Chip)][GetMixerSubindex(Channel)];
+	if (Index >= m_iTrackLevelCount)
+		return;
+
+	int &Peak = m_ChannelLevels[Index].Peak;
+	Peak = std::max(Peak, std::abs(Level));
+}
 
-	// Adjust channel levels for some channels
-	if (IsDPCM(Channel))
-		AbsVol /= 8.;
+void CMixer::SetStemChannels(const std::vector<stChannelID> &Channels)		// // //
+{
+	VisitMixers([] (auto &mixer) {
+		mixer.ClearStems();
+	});
+	m_StemBuffers.clear();
+	m_StemUpsamplers.clear();
+
+	for (stChannelID ch : Channels) {
+		auto &pBuffer = m_StemBuffers[ch];
+		pBuffer = std::make_unique<Blip_Buffer>();
+		SetupStemBuffer(*pBuffer);
+		m_StemUpsamplers[ch].SetFactor(m_iOversampling);		// // //
+		// the stem shares the chip's synth, so filtering and volume match the main output
+		WithMixer(GetMixerFromChannel(ch), [&] (auto &mixer) {
+			mixer.SetStemBuffer(GetMixerSubindex(ch), pBuffer.get());
+		});
+	}
+}
 
-	if (IsVRC6Sawtooth(Channel))
-		AbsVol = AbsVol * .75;
+void CMixer::AddVRC7StemValue(stChannelID Channel, int Value, int FrameCycles)		// // //
+{
+	if (auto it = m_StemBuffers.find(Channel); it != m_StemBuffers.end())
+		WithSynthQuality([&] (auto Q) {
+			levelsVRC7_.AddDelta<Q>(Value, FrameCycles, *it->second);
+		});
+}
 
-	if (Channel.Chip == sound_chip_t::FDS)
-		AbsVol /= 188.;
+int CMixer::ReadStem(stChannelID Channel, int Size, blip_sample_t *pBuffer)		// // //
+{
+	return ReadStemImpl(Channel, Size, pBuffer);
+}
 
-	if (Channel.Chip == sound_chip_t::N163) {		// // //
-		AbsVol /= 15.;
-		Channel.Subindex = static_cast<uint8_t>(enum_count<n163_subindex_t>() - 1 - Channel.Subindex);
-	}
+int CMixer::ReadStem(stChannelID Channel, int Size, float *pBuffer)		// // //
+{
+	return ReadStemImpl(Channel, Size, pBuffer);
+}
 
-	if (Channel.Chip == sound_chip_t::VRC7)		// // //
-		AbsVol = std::log(AbsVol) * 3.;
+template <typename T>
+int CMixer::ReadStemImpl(stChannelID Channel, int Size, T *pBuffer)		// // //
+{
+	auto it = m_StemBuffers.find(Channel);
+	if (it == m_StemBuffers.end())
+		return 0;
+	if (m_iOversampling > 1u)
+		return ReadUpsampled(*it->second, m_StemUpsamplers[Channel], Size, pBuffer, 1);
+	return it->second->read_samples(pBuffer, Size);
+}
 
-	if (Channel.Chip == sound_chip_t::S5B)		// // //
-		AbsVol = std::log(AbsVol) * 2.8;
+template <typename T>
+int CMixer::ReadUpsampled(Blip_Buffer &Buffer, CUpsampler &Upsampler, int Size, T *pBuffer, int Step)		// // //
+{
+	m_fUpsampleBuffer.resize(Size / m_iOversampling);
+	long Count = Buffer.read_samples(m_fUpsampleBuffer.data(), static_cast<long>(m_fUpsampleBuffer.size()));
+	Upsampler.Process(m_fUpsampleBuffer.data(), Count, pBuffer, Step);
+	return static_cast<int>(Count * m_iOversampling);
+}
 
-	auto &lv = m_ChannelLevels[Channel];
-	if (AbsVol >= lv.Level) {
-		lv.Level = (float)AbsVol;
-		lv.FallOff = LEVEL_FALL_OFF_DELAY;
-	}
+void CMixer::SerializeState(CStateArchive &ar)		// // //
+{
+	const auto SerializeBuffer = [&] (Blip_Buffer &Buffer) {
+		blip_buffer_state_t State = { };
+		if (!ar.IsLoading())
+			Buffer.save_state(&State);
+		ar(State);
+		if (ar.IsLoading())
+			Buffer.load_state(State);
+	};
+
+	SerializeBuffer(BlipBuffer);
+	if (m_bStereo)
+		SerializeBuffer(BlipBufferRight);
+	for (auto &x : m_StemBuffers)
+		SerializeBuffer(*x.second);
+
+	ar(m_Upsampler, m_UpsamplerRight);
+	for (auto &x : m_StemUpsamplers)
+		ar(x.second);
+
+	VisitMixers([&] (auto &mixer) {
+		ar(mixer);
+	});
+	ar(levelsVRC7_, m_ChannelLevels, m_fNamcoVolume);
+	if (ar.IsLoading())
+		ApplyNamcoVolume();
+}
+
+void CMixer::SetupStemBuffer(Blip_Buffer &Buffer) const		// // //
+{
+	if (!BlipBuffer.sample_rate())
+		return;
+	Buffer.set_sample_rate(BlipBuffer.sample_rate(), BlipBuffer.length());
+	Buffer.clock_rate(BlipBuffer.clock_rate());
+	Buffer.bass_freq(m_iLowCut);
 }
 
 uint32_t CMixer::ResampleDuration(uint32_t Time) const
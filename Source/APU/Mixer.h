@@ -25,10 +25,13 @@
 
 #include "APU/MixerChannel.h"		// // //
 #include "APU/MixerLevels.h"		// // //
+#include "APU/Upsampler.h"		// // //
 #include "Common.h"
 #include "Blip_Buffer/Blip_Buffer.h"
 #include <array>		// // //
 #include <map>		// // //
+#include <memory>		// // //
+#include <vector>		// // //
 #include "SoundChipSet.h"		// // //
 
 enum chip_level_t : unsigned char {
@@ -47,6 +50,9 @@ class CMixer
 {
 public:
 	void	AddValue(stChannelID ChanID, int Value, int FrameCycles);		// // //
+	void	AddValues(stChannelID Chan1, int Value1, stChannelID Chan2, int Value2, int FrameCycles);		// // //
+	void	AddVRC7Value(int Left, int Right, int FrameCycles);		// // // Right is ignored in mono
+	void	AddVRC7StemValue(stChannelID Channel, int Value, int FrameCycles);		// // //
 
 	void	ExternalSound(CSoundChipSet Chip);		// // //
 	void	UpdateSettings(int LowCut, int HighCut, int HighDamp, float OverallVol);
@@ -56,11 +62,17 @@ public:
 	void	ClearBuffer();
 	int		FinishBuffer(int t);
 	int		SamplesAvail() const;
-	void	MixSamples(blip_sample_t *pBuffer, uint32_t Count);
-	uint32_t	GetMixSampleCount(int t) const;
 
 	void	AddSample(int ChanID, int Value);
-	int		ReadBuffer(int Size, void *Buffer, bool Stereo);
+	int		ReadBuffer(int Size, blip_sample_t *Buffer, bool Stereo);		// // //
+	int		ReadBuffer(int Size, float *Buffer, bool Stereo);		// // // unclamped, 1.0 is full scale
+
+	// // // stereo panning, -1 is left and 1 is right; ignored unless the buffer has two channels
+	bool	IsStereo() const;
+
+	void	SetSynthQuality(synth_quality_t Quality);		// // //
+	void	SetChannelPan(stChannelID Channel, float Pan);
+	void	GetPanGains(stChannelID Channel, double &Left, double &Right) const;
 
 	int32_t	GetChanOutput(stChannelID Chan) const;		// // //
 	void	SetChipLevel(chip_level_t Chip, float Level);
@@ -71,11 +83,30 @@ public:
 	decay_rate_t GetMeterDecayRate() const;		// // // 050B
 	void	SetMeterDecayRate(decay_rate_t Rate);		// // // 050B
 
+	void	StoreChannelLevel(stChannelID Channel, int Level);		// // //
+
+	// // // per-channel stems, rendered alongside the main output
+	void	SetStemChannels(const std::vector<stChannelID> &Channels);
+	int		ReadStem(stChannelID Channel, int Size, blip_sample_t *pBuffer);
+	int		ReadStem(stChannelID Channel, int Size, float *pBuffer);		// // //
+
+	// // // synthesis state between frames, every buffer must have been read out
+	void	SerializeState(CStateArchive &ar);
+
 private:
 	void UpdateMeters();		// // //
-	void StoreChannelLevel(stChannelID Channel, int Level);		// // //
+	void MapChannelLevels(CSoundChipSet Chips);		// // //
+	void SetupStemBuffer(Blip_Buffer &Buffer) const;		// // //
 
 	float GetAttenuation() const;
+	void ApplyNamcoVolume();		// // //
+
+	template <typename T>
+	int ReadBufferImpl(int Size, T *Buffer, bool Stereo);		// // //
+	template <typename T>
+	int ReadStemImpl(stChannelID Channel, int Size, T *pBuffer);		// // //
+	template <typename T>
+	int ReadUpsampled(Blip_Buffer &Buffer, CUpsampler &Upsampler, int Size, T *pBuffer, int Step);		// // //
 
 	// template <typename T> void (*F)(CMixerChannel<T> &levels)
 	template <typename F>
@@ -85,9 +116,17 @@ private:
 	template <typename F>
 	void VisitMixers(F f);		// // //
 
+	// template <synth_quality_t Q> void (*F)(std::integral_constant<synth_quality_t, Q>)
+	template <typename F>
+	void WithSynthQuality(F f) const;		// // //
+
 private:
 	// Blip buffer object
 	Blip_Buffer	BlipBuffer;
+	Blip_Buffer	BlipBufferRight;		// // // only used in stereo
+	bool		m_bStereo = false;		// // //
+	synth_quality_t m_iSynthQuality = synth_quality_t::Good;		// // // passed to every channel offset
+	std::map<stChannelID, float> m_ChannelPan;		// // //
 
 	CMixerChannel<stLevels2A03SS>  levels2A03SS_  { 500.00};		// // //
 	CMixerChannel<stLevels2A03TND> levels2A03TND_ { 500.00};
@@ -96,17 +135,34 @@ private:
 	CMixerChannel<stLevelsMMC5>    levelsMMC5_    { 109.78};
 	CMixerChannel<stLevelsN163>    levelsN163_    {1454.5};
 	CMixerChannel<stLevelsS5B>     levelsS5B_     {1200.0};
+	CMixerChannelBase              levelsVRC7_    {65536.};		// // // the chip mixes and scales its own output
+
+	std::map<stChannelID, std::unique_ptr<Blip_Buffer>> m_StemBuffers;		// // //
+
+	// // // high sample rates that are a multiple of a base rate are synthesized at the
+	// base rate and interpolated, so that filters and the cost per channel stay the same
+	unsigned	m_iOversampling = 1u;
+	CUpsampler	m_Upsampler;
+	CUpsampler	m_UpsamplerRight;
+	std::map<stChannelID, CUpsampler> m_StemUpsamplers;
+	std::vector<float> m_fUpsampleBuffer;
 
 	CSoundChipSet m_iExternalChip;
-	uint32_t	m_iSampleRate = 0;
+	uint32_t	m_iSampleRate = 0;		// // // synthesis rate of the blip buffers
 
 	struct stTrackLevel {		// // //
+		stChannelID Channel;
+		int Peak = -1;			// // // largest raw level since the last frame, -1 if untouched
 		float Level = 0.f;
 		float LastLevel = 0.f;
 		uint32_t FallOff = 0u;
 	};
 
-	std::map<stChannelID, stTrackLevel> m_ChannelLevels;		// // //
+	// // // channel meters are assigned dense indices when the chips are selected
+	static constexpr std::uint8_t NO_TRACK_LEVEL = 0xFFu;
+	std::array<std::array<std::uint8_t, MAX_CHANNELS_N163>, SOUND_CHIP_COUNT> m_iTrackLevelIndex = { };		// N163 is the widest chip
+	std::array<stTrackLevel, CHANID_COUNT> m_ChannelLevels;		// // //
+	std::size_t m_iTrackLevelCount = 0u;		// // //
 
 	decay_rate_t m_iMeterDecayRate = decay_rate_t::Slow;		// // // 050B
 	int			m_iLowCut = 0;
@@ -115,4 +171,5 @@ private:
 	float		m_fOverallVol = 1.f;
 
 	bool		m_bNamcoMixing = false;		// // //
+	float		m_fNamcoVolume = 0.f;		// // // last N163 volume factor, 0 if never set
 };
@@ -23,12 +23,24 @@
 #include "APU/MixerChannel.h"
 
 CMixerChannelBase::CMixerChannelBase(double maxVol) :
-	synth_ {maxVol}
+	synths_(maxVol, maxVol, maxVol)		// // //
 {
+	gainLeft_.fill(1.);		// // //
+	gainRight_.fill(1.);
+}
+
+template <typename F>
+void CMixerChannelBase::WithSynth(F f) {		// // //
+	switch (quality_) {
+	case synth_quality_t::Fast: f(std::get<Blip_Synth<BLIP_QUALITY<synth_quality_t::Fast>>>(synths_)); break;
+	case synth_quality_t::Good: f(std::get<Blip_Synth<BLIP_QUALITY<synth_quality_t::Good>>>(synths_)); break;
+	case synth_quality_t::High: f(std::get<Blip_Synth<BLIP_QUALITY<synth_quality_t::High>>>(synths_)); break;
+	}
 }
 
 void CMixerChannelBase::SetVolume(double vol) {
-	synth_.volume(level_ * vol);
+	volume_ = level_ * vol;		// // //
+	WithSynth([&] (auto &synth) { synth.volume(volume_); });
 }
 
 void CMixerChannelBase::SetMixerLevel(double level) {
@@ -36,5 +48,31 @@ void CMixerChannelBase::SetMixerLevel(double level) {
 }
 
 void CMixerChannelBase::SetLowPass(const blip_eq_t &eq) {
-	synth_.treble_eq(eq);
+	eq_ = eq;		// // //
+	WithSynth([&] (auto &synth) { synth.treble_eq(eq_); });
+}
+
+void CMixerChannelBase::SetQuality(synth_quality_t Quality) {		// // //
+	// the other synths keep their old settings until they become active again
+	quality_ = Quality;
+	WithSynth([&] (auto &synth) {
+		synth.treble_eq(eq_);
+		synth.volume(volume_);
+	});
+}
+
+void CMixerChannelBase::SetRightBuffer(Blip_Buffer *pBuffer) {		// // //
+	pRight_ = pBuffer;
+	lastSumRight_ = 0.;
+}
+
+void CMixerChannelBase::SetPan(std::uint8_t Subindex, double Left, double Right) {		// // //
+	if (Subindex < gainLeft_.size()) {
+		gainLeft_[Subindex] = Left;
+		gainRight_[Subindex] = Right;
+	}
+}
+
+void CMixerChannelBase::SerializeState(CStateArchive &ar) {		// // //
+	ar(lastSum_, lastSumRight_);
 }
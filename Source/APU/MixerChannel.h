@@ -25,6 +25,16 @@
 
 #include "APU/Types.h"
 #include "Blip_Buffer/Blip_Buffer.h"
+#include "Common.h"		// // //
+#include "StateArchive.h"		// // //
+#include <vector>		// // //
+#include <array>		// // //
+#include <tuple>		// // //
+
+// // // Blip_Synth quality of each synthesis tier
+template <synth_quality_t Q>
+inline constexpr int BLIP_QUALITY = Q == synth_quality_t::Fast ? blip_med_quality :
+	Q == synth_quality_t::High ? blip_high_quality : blip_good_quality;
 
 class CMixerChannelBase {
 public:
@@ -33,12 +43,41 @@ public:
 	void SetVolume(double vol);
 	void SetMixerLevel(double level);
 	void SetLowPass(const blip_eq_t &eq);
+	void SetQuality(synth_quality_t Quality);		// // // keeps the volume and low-pass
+
+	// // // for chips that mix their own output, Q must be the tier given to SetQuality
+	template <synth_quality_t Q>
+	void AddDelta(int Delta, int FrameCycles, Blip_Buffer &bb) const {
+		Offset<Q>(FrameCycles, Delta, &bb);
+	}
+
+	// // // stereo output, the main buffer becomes the left side
+	void SetRightBuffer(Blip_Buffer *pBuffer);
+	void SetPan(std::uint8_t Subindex, double Left, double Right);
+
+	void SerializeState(CStateArchive &ar);		// // // the last output levels, not the settings
 
 private:
 	template <typename> friend class CMixerChannel;
-	Blip_Synth<blip_good_quality> synth_;
+	template <synth_quality_t Q>
+	void Offset(int FrameCycles, int Delta, Blip_Buffer *bb) const {		// // //
+		std::get<Blip_Synth<BLIP_QUALITY<Q>>>(synths_).offset(FrameCycles, Delta, bb);
+	}
+	template <typename F>
+	void WithSynth(F f);		// // // the active tier's synth
+
+	// // // one synth per tier, only the active one is kept up to date; the mixer
+	// picks the tier once and passes it to every offset as a template argument
+	std::tuple<Blip_Synth<blip_med_quality>, Blip_Synth<blip_good_quality>, Blip_Synth<blip_high_quality>> synths_;
+	synth_quality_t quality_ = synth_quality_t::Good;
+	double volume_ = 1.;		// // //
+	blip_eq_t eq_ {-8.};		// // // Blip_Synth's default
 	double level_ = 1.;
 	double lastSum_ = 0.;
+	double lastSumRight_ = 0.;		// // //
+	Blip_Buffer *pRight_ = nullptr;		// // //
+	std::array<double, MAX_CHANNELS_N163> gainLeft_;		// // // by subindex, N163 is the widest chip
+	std::array<double, MAX_CHANNELS_N163> gainRight_;
 };
 
 template <typename LevelsT>
@@ -46,20 +85,93 @@ class CMixerChannel : public CMixerChannelBase {
 public:
 	using CMixerChannelBase::CMixerChannelBase;
 
+	// // // Q must be the tier given to SetQuality
+	template <synth_quality_t Q>
 	int AddValue(stChannelID ChanID, int Value, int FrameCycles, Blip_Buffer &bb) {
-		const int level = levels_.Offset(enum_cast<typename LevelsT::subindex_t>(ChanID.Subindex), Value);
+		const int level = OffsetLevel<Q>(ChanID, Value, FrameCycles);		// // //
+		UpdateOutput<Q>(FrameCycles, bb);
+		return level;
+	}
+
+	// // // changes one channel's level without touching the main output yet
+	template <synth_quality_t Q>
+	int OffsetLevel(stChannelID ChanID, int Value, int FrameCycles) {
+		const auto subindex = enum_cast<typename LevelsT::subindex_t>(ChanID.Subindex);		// // //
+		const int level = levels_.Offset(subindex, Value);
+
+		// // // the stem sees only this channel, as if all others were muted
+		if (ChanID.Subindex < stems_.size())
+			if (auto &stem = stems_[ChanID.Subindex]; stem.pBuffer) {
+				stem.levels.Offset(subindex, Value);
+				const double prevStem = stem.lastSum;
+				stem.lastSum = stem.levels.CalcPin();
+				Offset<Q>(FrameCycles, static_cast<int>(stem.lastSum - prevStem), stem.pBuffer);
+			}
+
+		return level;
+	}
+
+	// // // adds every level change since the last call as one synth offset
+	template <synth_quality_t Q>
+	void UpdateOutput(int FrameCycles, Blip_Buffer &bb) {
+		if (pRight_) {		// // // each side has its own pin, so nonlinear mixing stays per side
+			UpdateSide<Q>(FrameCycles, bb, gainLeft_.data(), lastSum_);
+			UpdateSide<Q>(FrameCycles, *pRight_, gainRight_.data(), lastSumRight_);
+			return;
+		}
 		const double prev = lastSum_;
 		lastSum_ = levels_.CalcPin();
 		const double Delta = lastSum_ - prev;
-		synth_.offset(FrameCycles, static_cast<int>(Delta), &bb);
-		return level;
+		if (Delta != 0.)
+			Offset<Q>(FrameCycles, static_cast<int>(Delta), &bb);
 	}
 
 	void ResetDelta() {
 		lastSum_ = 0;
+		lastSumRight_ = 0;		// // //
 		levels_ = LevelsT { };
+		for (auto &stem : stems_) {		// // //
+			stem.lastSum = 0;
+			stem.levels = LevelsT { };
+		}
+	}
+
+	// // // nullptr removes the stem
+	void SetStemBuffer(std::uint8_t Subindex, Blip_Buffer *pBuffer) {
+		if (Subindex >= stems_.size())
+			stems_.resize(Subindex + 1);
+		auto &stem = stems_[Subindex];
+		stem = stStem { };
+		stem.pBuffer = pBuffer;
+	}
+
+	void ClearStems() {		// // //
+		stems_.clear();
+	}
+
+	void SerializeState(CStateArchive &ar) {		// // //
+		CMixerChannelBase::SerializeState(ar);
+		ar(levels_);
+		for (auto &stem : stems_)
+			ar(stem.levels, stem.lastSum);
 	}
 
 private:
+	template <synth_quality_t Q>
+	void UpdateSide(int FrameCycles, Blip_Buffer &bb, const double *Gain, double &LastSum) {		// // //
+		const double prev = LastSum;
+		LastSum = levels_.CalcPin(Gain);
+		const double Delta = LastSum - prev;
+		if (Delta != 0.)
+			Offset<Q>(FrameCycles, static_cast<int>(Delta), &bb);
+	}
+
+	struct stStem {		// // //
+		Blip_Buffer *pBuffer = nullptr;
+		LevelsT levels;
+		double lastSum = 0.;
+	};
+
 	LevelsT levels_;
+	std::vector<stStem> stems_;		// // //
 };
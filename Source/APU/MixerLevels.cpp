@@ -47,6 +47,13 @@ double stLevels2A03SS::CalcPin() const {
 	return 0.;
 }
 
+double stLevels2A03SS::CalcPin(const double *Gain) const {		// // //
+	double sum = sq1_ * Gain[value_cast(apu_subindex_t::pulse1)] + sq2_ * Gain[value_cast(apu_subindex_t::pulse2)];
+	if (sum > 0.)
+		return AMP_2A03 * 95.88 / (100.0 + 8128.0 / sum);
+	return 0.;
+}
+
 
 
 int stLevels2A03TND::Offset(apu_subindex_t subindex, int val) {
@@ -67,3 +74,12 @@ double stLevels2A03TND::CalcPin() const {
 		return AMP_2A03 * 159.79 / (100.0 + 1.0 / (tri_ / 8227.0 + noi_ / 12241.0 + dmc_ / 22638.0));
 	return 0.;
 }
+
+double stLevels2A03TND::CalcPin(const double *Gain) const {		// // //
+	double tri = tri_ * Gain[value_cast(apu_subindex_t::triangle)];
+	double noi = noi_ * Gain[value_cast(apu_subindex_t::noise)];
+	double dmc = dmc_ * Gain[value_cast(apu_subindex_t::dpcm)];
+	if ((tri + noi + dmc) > 0.)
+		return AMP_2A03 * 159.79 / (100.0 + 1.0 / (tri / 8227.0 + noi / 12241.0 + dmc / 22638.0));
+	return 0.;
+}
@@ -33,6 +33,7 @@ struct stLevels2A03SS {
 	using subindex_t = apu_subindex_t;
 	int Offset(apu_subindex_t subindex, int val);
 	double CalcPin() const;
+	double CalcPin(const double *Gain) const;		// // // levels weighted by subindex
 
 private:
 	int sq1_ = 0;
@@ -45,6 +46,7 @@ struct stLevels2A03TND {
 	using subindex_t = apu_subindex_t;
 	int Offset(apu_subindex_t subindex, int val);
 	double CalcPin() const;
+	double CalcPin(const double *Gain) const;		// // //
 
 private:
 	int tri_ = 0;
@@ -72,6 +74,14 @@ public:
 		return tot_;
 	}
 
+	double CalcPin(const double *Gain) const {		// // //
+		const T2 subindices[] = {value_cast(Subindices)...};
+		double sum = 0.;
+		for (std::size_t i = 0; i < sizeof...(Subindices); ++i)
+			sum += lvl_[i] * Gain[subindices[i]];
+		return sum;
+	}
+
 private:
 	int Offset(EnumT ChanID, int val, std::integer_sequence<T2>, std::index_sequence<>) {
 		return 0;
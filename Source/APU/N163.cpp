@@ -24,6 +24,7 @@
 #include "APU/Mixer.h"		// // //
 #include "RegisterState.h"		// // //
 #include <algorithm>		// // //
+#include "StateArchive.h"		// // //
 
 /*
 
@@ -71,11 +72,13 @@ void CN163::Reset()
 	m_iChannelCntr = 0;
 	m_iLastChan = m_iActiveChan = 7;		// // //
 	m_iCycle = 0;
+	m_iVolumeChans = -1;		// // //
 }
 
 void CN163::SetMixingMethod(bool bLinear)		// // //
 {
 	m_bOldMixing = bLinear;
+	m_iVolumeChans = -1;
 	for (auto &ch : m_Channels)
 		ch.Reset();
 }
@@ -89,13 +92,15 @@ void CN163::Process(uint32_t Time)
 
 	const uint32_t CHAN_PERIOD = 15;		// 15 cycles/channel
 
-	m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.3f : (1.5f + float(m_iChansInUse - 1) / 1.5f));
+	UpdateNamcoVolume();		// // //
+	const uint8_t ChansActive = m_iChansInUse + 1;
 
 	while (Time > 0) {
 		uint32_t TimeToRun = std::min(Time, CHAN_PERIOD - m_iChannelCntr);		// // //
 
-		Mix(0, 0, m_Channels[m_iLastChan].GetChannelType());		// // //
-		m_Channels[m_iActiveChan].Process(TimeToRun, m_iChansInUse + 1);		// // //
+		CN163Chan &Chan = m_Channels[m_iActiveChan];		// // //
+		SwitchChannel(m_Channels[m_iLastChan].GetChannelType(), Chan);
+		Chan.Process(TimeToRun, ChansActive);
 		m_iLastChan = m_iActiveChan;
 
 		Time -= TimeToRun;
@@ -113,12 +118,39 @@ void CN163::Process(uint32_t Time)
 
 void CN163::ProcessOld(uint32_t Time)		// // //
 {
-	m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.0f : 0.75f);
+	UpdateNamcoVolume();		// // //
 
 	for (int i = 7 - m_iChansInUse; i < MAX_CHANNELS_N163; ++i)
 		m_Channels[i].ProcessClean(Time, m_iChansInUse + 1);
 }
 
+void CN163::UpdateNamcoVolume()		// // //
+{
+	// the mixer keeps the volume across setting changes, so only a new channel count needs it
+	if (m_iVolumeChans == m_iChansInUse)
+		return;
+	m_iVolumeChans = m_iChansInUse;
+
+	if (m_bOldMixing)
+		m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.0f : 0.75f);
+	else
+		m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.3f : (1.5f + float(m_iChansInUse - 1) / 1.5f));
+}
+
+void CN163::SwitchChannel(stChannelID From, const CN163Chan &To)		// // //
+{
+	// same as muting the last channel and then mixing the active one, but the shared DAC
+	// only moves once when both happen
+	const int32_t Value = To.GetLastSample();
+	if (m_iLastValue != 0 && Value != 0)
+		m_pMixer->AddValues(From, -m_iLastValue, To.GetChannelType(), Value, m_iGlobalTime);
+	else if (m_iLastValue != 0)
+		m_pMixer->AddValue(From, -m_iLastValue, m_iGlobalTime);
+	else if (Value != 0)
+		m_pMixer->AddValue(To.GetChannelType(), Value, m_iGlobalTime);
+	m_iLastValue = Value;
+}
+
 void CN163::Mix(int32_t Value, uint32_t Time, stChannelID ChanID)		// // //
 {
 	// N163 amplitude:
@@ -284,10 +316,9 @@ void CN163Chan::Write(uint16_t Address, uint8_t Value)
 
 void CN163Chan::Process(uint32_t Time, uint8_t ChannelsActive)		// // //
 {
+	// // // the parent has already switched the DAC to this channel
 	uint32_t TimeStamp = 0;
 
-	parent_.Mix(m_iLastSample, TimeStamp, m_iChanId);
-
 	if (!m_iFrequency || !m_iWaveLength) {
 		m_iLastSample = 0;
 		m_iTime += Time;
@@ -300,16 +331,7 @@ void CN163Chan::Process(uint32_t Time, uint8_t ChannelsActive)		// // //
 		TimeStamp += m_iCounter;
 		m_iCounter = 15;
 
-		m_iPhase = (m_iPhase + m_iFrequency) % m_iWaveLength;
-
-		int WavePtr = m_iPhase >> 16;
-
-		uint8_t Sample = m_pWaveData[((WavePtr + m_iWaveOffset) & 0xFF) >> 1];
-
-		if (WavePtr & 1)
-			Sample >>= 4;
-
-		m_iLastSample = (Sample & 0x0F) * m_iVolume;
+		m_iLastSample = Step() * m_iVolume;		// // //
 
 		parent_.Mix(m_iLastSample, TimeStamp, m_iChanId);
 	}
@@ -332,16 +354,7 @@ void CN163Chan::ProcessClean(uint32_t Time, uint8_t ChannelsActive)
 		m_iTime += m_iCounter;
 		m_iCounter = 15 * ChannelsActive;
 
-		m_iPhase = (m_iPhase + m_iFrequency) % m_iWaveLength;
-
-		int WavePtr = m_iPhase >> 16;
-
-		uint8_t Sample = m_pWaveData[((WavePtr + m_iWaveOffset) & 0xFF) >> 1];
-
-		if (WavePtr & 1)
-			Sample >>= 4;
-
-		Mix((Sample & 0x0F) * m_iVolume);
+		Mix(Step() * m_iVolume);		// // //
 	}
 
 	m_iCounter -= Time;
@@ -381,3 +394,38 @@ double CN163Chan::GetFrequency() const		// // //
 {
 	return MASTER_CLOCK_NTSC / 983040. * m_iFrequency / (m_iWaveLength >> 16);
 }
+
+uint8_t CN163Chan::GetLastSample() const		// // //
+{
+	return m_iLastSample;
+}
+
+uint8_t CN163Chan::Step()		// // //
+{
+	// the phase only exceeds the wave length after a register write, so the division is rarely needed
+	m_iPhase += m_iFrequency;
+	if (m_iPhase >= m_iWaveLength)
+		m_iPhase = m_iPhase < (m_iWaveLength << 1) ? m_iPhase - m_iWaveLength : m_iPhase % m_iWaveLength;
+
+	int WavePtr = m_iPhase >> 16;
+
+	uint8_t Sample = m_pWaveData[((WavePtr + m_iWaveOffset) & 0xFF) >> 1];
+
+	if (WavePtr & 1)
+		Sample >>= 4;
+
+	return Sample & 0x0F;
+}
+
+void CN163::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	ar(m_Channels, m_iWaveData, m_iExpandAddr, m_iChansInUse, m_iLastValue, m_iGlobalTime,
+		m_iChannelCntr, m_iActiveChan, m_iLastChan, m_iCycle, m_iVolumeChans);
+}
+
+void CN163Chan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iCounter, m_iFrequency, m_iPhase, m_iWaveLength, m_iVolume, m_iWaveOffset, m_iLastSample);
+}
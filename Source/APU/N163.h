@@ -44,6 +44,11 @@ public:
 	uint8_t ReadMem(uint8_t Reg);
 	void ResetCounter();
 	double GetFrequency() const;		// // //
+	uint8_t GetLastSample() const;		// // //
+	void SerializeState(CStateArchive &ar);		// // //
+
+private:
+	uint8_t Step();		// // //
 
 private:
 	uint32_t	m_iCounter, m_iFrequency;
@@ -76,12 +81,15 @@ public:
 	void Log(uint16_t Address, uint8_t Value) override;		// // //
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 	void Mix(int32_t Value, uint32_t Time, stChannelID ChanID);		// // //
 	void SetMixingMethod(bool bLinear);		// // //
 
 protected:
 	void ProcessOld(uint32_t Time);		// // //
+	void UpdateNamcoVolume();		// // //
+	void SwitchChannel(stChannelID From, const CN163Chan &To);		// // //
 
 private:
 	CN163Chan	m_Channels[MAX_CHANNELS_N163];		// // //
@@ -100,4 +108,5 @@ private:
 	uint32_t	m_iCycle = 0;
 
 	bool		m_bOldMixing = false;		// // //
+	int			m_iVolumeChans = -1;		// // // channel count of the last namco volume, -1 if stale
 };
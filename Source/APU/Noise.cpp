@@ -22,6 +22,7 @@
 
 #include "APU/Noise.h"
 #include "APU/Types.h"		// // //
+#include "StateArchive.h"		// // //
 
 const uint16_t CNoise::NOISE_PERIODS_NTSC[16] = {
 	4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
@@ -105,14 +106,22 @@ uint8_t CNoise::ReadControl()
 void CNoise::Process(uint32_t Time)
 {
 	bool Valid = m_iEnabled && (m_iLengthCounter > 0);
+	uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
 
 	while (Time >= m_iCounter) {
 		Time	  -= m_iCounter;
 		m_iTime	  += m_iCounter;
 		m_iCounter = m_iPeriod;
-		uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
 		Mix(Valid && (m_iShiftReg & 1) ? Volume : 0);
 		m_iShiftReg = (((m_iShiftReg << 14) ^ (m_iShiftReg << m_iSampleRate)) & 0x4000) | (m_iShiftReg >> 1);
+
+		if (!Valid || !Volume) {		// // // output stays at 0, only clock the shift register
+			uint32_t Skip = Time / m_iPeriod;
+			Time	-= Skip * m_iPeriod;
+			m_iTime += Skip * m_iPeriod;
+			while (Skip--)
+				m_iShiftReg = (((m_iShiftReg << 14) ^ (m_iShiftReg << m_iSampleRate)) & 0x4000) | (m_iShiftReg >> 1);
+		}
 	}
 
 	m_iCounter -= Time;
@@ -145,3 +154,10 @@ void CNoise::EnvelopeUpdate()
 		}
 	}
 }
+
+void CNoise::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed, m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter,
+		m_iSampleRate, m_iShiftReg);
+}
@@ -41,6 +41,7 @@ public:
 	uint8_t	ReadControl();
 	void	Process(uint32_t Time);
 	double	GetFrequency() const;		// // //
+	void	SerializeState(CStateArchive &ar);		// // //
 
 	void	LengthCounterUpdate();
 	void	EnvelopeUpdate();
@@ -0,0 +1,49 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "APU/Types_fwd.h"
+#include "SoundChipSet.h"
+
+namespace ft0cc::doc {
+class dpcm_sample;
+} // namespace ft0cc::doc
+
+// // // receives every call that changes the state of the sound chips, in the
+// order the APU sees them; attach with CAPU::AddListener
+class CRegisterListener {
+public:
+	virtual ~CRegisterListener() noexcept = default;
+
+	virtual void AddRun(std::uint32_t Cycles) = 0;
+	virtual void AddWrite(std::uint16_t Address, std::uint8_t Value) = 0;
+	virtual void AddRead(std::uint16_t Address) = 0;
+	virtual void AddEndFrame() = 0;
+	virtual void AddReset() = 0;
+	virtual void AddSample(const std::shared_ptr<const ft0cc::doc::dpcm_sample> &pSample) = 0;
+	virtual void AddMachine(machine_t Machine) = 0;
+	virtual void AddChips(CSoundChipSet Chips) = 0;
+};
@@ -0,0 +1,299 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "APU/RegisterTrace.h"
+#include "APU/Types.h"
+#include "APU/APU.h"
+#include "SimpleFile.h"
+#include "ft0cc/doc/dpcm_sample.hpp"
+#include <algorithm>
+
+namespace {
+
+struct stTraceEvent {
+	trace_event_t Event;
+	std::uint32_t Number = 0u;
+	std::uint16_t Address = 0u;
+	std::uint8_t Value = 0u;
+	array_view<std::uint8_t> Data;
+};
+
+bool GetNumber(array_view<std::uint8_t> Data, std::size_t &Pos, std::uint32_t &x) {
+	x = 0u;
+	for (unsigned Shift = 0u; Shift < 32u; Shift += 7u) {
+		if (Pos >= Data.size())
+			return false;
+		std::uint8_t b = Data[Pos++];
+		x |= static_cast<std::uint32_t>(b & 0x7Fu) << Shift;
+		if (!(b & 0x80u))
+			return true;
+	}
+	return false;
+}
+
+// decodes the event at Pos and moves past it, returns false if the data is malformed
+bool GetEvent(array_view<std::uint8_t> Data, std::size_t &Pos, stTraceEvent &ev) {
+	if (Pos >= Data.size())
+		return false;
+	ev.Event = static_cast<trace_event_t>(Data[Pos++]);
+	switch (ev.Event) {
+	case trace_event_t::run:
+	case trace_event_t::sample:
+	case trace_event_t::chips:
+		return GetNumber(Data, Pos, ev.Number);
+	case trace_event_t::write:
+	case trace_event_t::read:
+		if (Data.size() - Pos < (ev.Event == trace_event_t::write ? 3u : 2u))
+			return false;
+		ev.Address = static_cast<std::uint16_t>(Data[Pos] | (Data[Pos + 1] << 8));
+		Pos += 2;
+		if (ev.Event == trace_event_t::write)
+			ev.Value = Data[Pos++];
+		return true;
+	case trace_event_t::end_frame:
+	case trace_event_t::reset:
+		return true;
+	case trace_event_t::sample_data:
+		if (!GetNumber(Data, Pos, ev.Number) || Data.size() - Pos < ev.Number)
+			return false;
+		ev.Data = Data.subview(Pos, ev.Number);
+		Pos += ev.Number;
+		return true;
+	case trace_event_t::machine:
+		if (Pos >= Data.size())
+			return false;
+		ev.Value = Data[Pos++];
+		return enum_cast<machine_t>(ev.Value) != machine_t::none;
+	}
+	return false;
+}
+
+} // namespace
+
+void CRegisterTrace::Clear() {
+	data_.clear();
+	samples_.clear();
+	frames_ = 0u;
+	writes_ = 0u;
+	machine_ = { };
+	chips_ = CSoundChipSet { };
+	hasMachine_ = false;
+}
+
+void CRegisterTrace::AddRun(std::uint32_t Cycles) {
+	PutEvent(trace_event_t::run);
+	PutNumber(Cycles);
+}
+
+void CRegisterTrace::AddWrite(std::uint16_t Address, std::uint8_t Value) {
+	PutEvent(trace_event_t::write);
+	data_.push_back(static_cast<std::uint8_t>(Address));
+	data_.push_back(static_cast<std::uint8_t>(Address >> 8));
+	data_.push_back(Value);
+	++writes_;
+}
+
+void CRegisterTrace::AddRead(std::uint16_t Address) {
+	PutEvent(trace_event_t::read);
+	data_.push_back(static_cast<std::uint8_t>(Address));
+	data_.push_back(static_cast<std::uint8_t>(Address >> 8));
+}
+
+void CRegisterTrace::AddEndFrame() {
+	PutEvent(trace_event_t::end_frame);
+	++frames_;
+}
+
+void CRegisterTrace::AddReset() {
+	PutEvent(trace_event_t::reset);
+}
+
+void CRegisterTrace::AddSample(const std::shared_ptr<const ft0cc::doc::dpcm_sample> &pSample) {
+	// samples are identified by object, the same sample is only stored once
+	auto it = std::find(samples_.begin(), samples_.end(), pSample);
+	if (it == samples_.end()) {
+		PutEvent(trace_event_t::sample_data);
+		PutNumber(static_cast<std::uint32_t>(pSample->size()));
+		data_.insert(data_.end(), pSample->data(), pSample->data() + pSample->size());
+		it = samples_.insert(it, pSample);
+	}
+	PutEvent(trace_event_t::sample);
+	PutNumber(static_cast<std::uint32_t>(it - samples_.begin()));
+}
+
+void CRegisterTrace::AddMachine(machine_t Machine) {
+	PutEvent(trace_event_t::machine);
+	data_.push_back(value_cast(Machine));
+	if (!hasMachine_) {
+		machine_ = Machine;
+		hasMachine_ = true;
+	}
+}
+
+void CRegisterTrace::AddChips(CSoundChipSet Chips) {
+	PutEvent(trace_event_t::chips);
+	PutNumber(Chips.GetFlag());
+	chips_ = chips_.MergedWith(Chips);
+}
+
+array_view<std::uint8_t> CRegisterTrace::GetData() const {
+	return data_;
+}
+
+unsigned CRegisterTrace::GetFrameCount() const {
+	return frames_;
+}
+
+std::size_t CRegisterTrace::GetWriteCount() const {
+	return writes_;
+}
+
+machine_t CRegisterTrace::GetMachine() const {
+	return machine_;
+}
+
+CSoundChipSet CRegisterTrace::GetChips() const {
+	return chips_;
+}
+
+void CRegisterTrace::Write(CSimpleFile &file) const {
+	file.WriteBytes(array_view<char> {MAGIC, std::size(MAGIC) - 1});
+	file.WriteInt8(VERSION);
+	file.WriteInt32(static_cast<std::int32_t>(data_.size()));
+	file.WriteBytes(array_view<unsigned char> {data_.data(), data_.size()});
+}
+
+bool CRegisterTrace::Read(CSimpleFile &file) {
+	Clear();
+
+	char magic[std::size(MAGIC) - 1] = { };
+	if (file.ReadBytes(magic, std::size(magic)) != std::size(magic) ||
+		!std::equal(std::begin(magic), std::end(magic), MAGIC) || file.ReadUint8() != VERSION)
+		return false;
+	std::size_t Size = file.ReadUint32();
+	// checked before allocating, a corrupt size must not reserve more than the file holds
+	if (!file || Size > file.GetLength() - file.GetPosition())
+		return false;
+	data_.resize(Size);
+	if (file.ReadBytes(data_.data(), Size) != Size) {
+		Clear();
+		return false;
+	}
+
+	// check every event once, so that replaying does not need to
+	std::size_t Pos = 0u;
+	std::uint64_t FrameCycles = 0u;
+	while (Pos < data_.size()) {
+		stTraceEvent ev;
+		if (!GetEvent(data_, Pos, ev) ||
+			(ev.Event == trace_event_t::sample && ev.Number >= samples_.size())) {
+			Clear();
+			return false;
+		}
+		switch (ev.Event) {
+		case trace_event_t::run:
+			// a frame longer than the APU's sample buffer would overrun it on replay
+			FrameCycles += ev.Number;
+			if (FrameCycles > CAPU::MAX_FRAME_CYCLES) {
+				Clear();
+				return false;
+			}
+			break;
+		case trace_event_t::write:
+			++writes_;
+			break;
+		case trace_event_t::end_frame:
+			FrameCycles = 0u;
+			++frames_;
+			break;
+		case trace_event_t::reset:
+			FrameCycles = 0u;
+			break;
+		case trace_event_t::sample_data:
+			samples_.push_back(std::make_shared<ft0cc::doc::dpcm_sample>(
+				std::vector<std::uint8_t>(ev.Data.begin(), ev.Data.end()), ""));
+			break;
+		case trace_event_t::machine:
+			if (!hasMachine_) {
+				machine_ = enum_cast<machine_t>(ev.Value);
+				hasMachine_ = true;
+			}
+			break;
+		case trace_event_t::chips:
+			chips_ = chips_.MergedWith(CSoundChipSet::FromFlag(ev.Number));
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+std::size_t CRegisterTrace::ReplayFrame(CAPU &apu, std::size_t Pos) const {
+	stTraceEvent ev;
+	while (GetEvent(data_, Pos, ev)) {
+		switch (ev.Event) {
+		case trace_event_t::run:
+			apu.AddTime(ev.Number);
+			apu.Process();
+			break;
+		case trace_event_t::write:
+			apu.Write(ev.Address, ev.Value);
+			break;
+		case trace_event_t::read:
+			apu.Read(ev.Address);
+			break;
+		case trace_event_t::end_frame:
+			apu.EndFrame();
+			return Pos;
+		case trace_event_t::reset:
+			apu.Reset();
+			break;
+		case trace_event_t::sample:
+			apu.WriteSample(samples_[ev.Number]);
+			break;
+		case trace_event_t::sample_data:
+			break;
+		case trace_event_t::machine: {
+			machine_t Machine = enum_cast<machine_t>(ev.Value);
+			apu.ChangeMachineRate(Machine, Machine == machine_t::NTSC ? FRAME_RATE_NTSC : FRAME_RATE_PAL);
+		} break;
+		case trace_event_t::chips:
+			apu.SetExternalSound(CSoundChipSet::FromFlag(ev.Number));
+			break;
+		}
+	}
+	return data_.size();
+}
+
+void CRegisterTrace::PutEvent(trace_event_t Event) {
+	data_.push_back(value_cast(Event));
+}
+
+void CRegisterTrace::PutNumber(std::uint32_t x) {
+	while (x >= 0x80u) {
+		data_.push_back(static_cast<std::uint8_t>(x | 0x80u));
+		x >>= 7;
+	}
+	data_.push_back(static_cast<std::uint8_t>(x));
+}
@@ -0,0 +1,99 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "APU/Types_fwd.h"
+#include "APU/RegisterListener.h"
+#include "SoundChipSet.h"
+#include "array_view.h"
+
+class CSimpleFile;
+class CAPU;
+
+// // // events of a register trace, each one is a tag byte followed by its operands
+enum class trace_event_t : std::uint8_t {
+	run,		// number of cycles emulated by CAPU::Process
+	write,		// 16-bit address, 8-bit value
+	read,		// 16-bit address, reads have side effects on some chips
+	end_frame,
+	reset,
+	sample,		// index of a DPCM sample
+	sample_data,	// size and data of the next DPCM sample, sent before its first use
+	machine,	// machine_t
+	chips,		// CSoundChipSet flag
+};
+
+// // // lossless log of everything the sound driver asks of the APU, enough to
+// render the same audio again without the driver. Addresses and values are
+// stored as is and every other number is a variable-length integer, 7 bits per
+// byte starting from the least significant. Writes happen after all cycles run
+// before them, so the cycle of a write is the total length of the runs since
+// the last end of frame or reset. Every event can be decoded without the ones
+// before it.
+class CRegisterTrace : public CRegisterListener {
+public:
+	static constexpr char MAGIC[] = "0CCTRACE";
+	static constexpr std::uint8_t VERSION = 1u;
+
+	void Clear();
+
+	void AddRun(std::uint32_t Cycles) override;
+	void AddWrite(std::uint16_t Address, std::uint8_t Value) override;
+	void AddRead(std::uint16_t Address) override;
+	void AddEndFrame() override;
+	void AddReset() override;
+	void AddSample(const std::shared_ptr<const ft0cc::doc::dpcm_sample> &pSample) override;
+	void AddMachine(machine_t Machine) override;
+	void AddChips(CSoundChipSet Chips) override;
+
+	array_view<std::uint8_t> GetData() const;
+	unsigned GetFrameCount() const;
+	std::size_t GetWriteCount() const;
+	machine_t GetMachine() const;		// the first machine used
+	CSoundChipSet GetChips() const;		// every chip that was enabled at some point
+
+	void Write(CSimpleFile &file) const;
+	bool Read(CSimpleFile &file);		// false if the file is not a valid trace
+
+	// replays the events from Pos up to the next end of frame, returns the
+	// position after it, or the size of the trace after the last frame
+	std::size_t ReplayFrame(CAPU &apu, std::size_t Pos) const;
+
+private:
+	void PutEvent(trace_event_t Event);
+	void PutNumber(std::uint32_t x);
+
+private:
+	std::vector<std::uint8_t> data_;
+	std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> samples_;
+	unsigned frames_ = 0u;
+	std::size_t writes_ = 0u;
+	machine_t machine_ { };
+	CSoundChipSet chips_;
+	bool hasMachine_ = false;
+};
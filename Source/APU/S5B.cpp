@@ -24,6 +24,7 @@
 #include <algorithm>
 #include "APU/Types.h"		// // //
 #include "RegisterState.h"
+#include "StateArchive.h"		// // //
 
 // // // 050B
 // Sunsoft 5B channel class
@@ -284,3 +285,16 @@ void CS5B::RunNoise(uint32_t Time)
 		m_iNoiseState >>= 1;
 	}
 }
+
+void CS5B::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	ar(m_Channel, m_cPort, m_iCounter, m_iNoisePeriod, m_iNoiseClock, m_iNoiseState,
+		m_iEnvelopePeriod, m_iEnvelopeClock, m_iEnvelopeLevel, m_iEnvelopeShape, m_bEnvelopeHold);
+}
+
+void CS5BChannel::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iVolume, m_iPeriod, m_iPeriodClock, m_bSquareHigh, m_bSquareDisable, m_bNoiseDisable);
+}
@@ -42,6 +42,7 @@ public:
 	void Output(uint32_t Noise, uint32_t Envelope);
 
 	double GetFrequency() const;
+	void SerializeState(CStateArchive &ar);		// // //
 
 private:
 	uint8_t m_iVolume;
@@ -70,6 +71,7 @@ public:
 	void	Log(uint16_t Address, uint8_t Value) override;		// // //
 
 	double	GetFreq(int Channel) const override;		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	void	WriteReg(uint8_t Port, uint8_t Value);
@@ -22,6 +22,7 @@
 
 #include "APU/SoundChip.h"
 #include "RegisterState.h"
+#include "StateArchive.h"		// // //
 
 CSoundChip::CSoundChip(CMixer &Mixer, std::uint8_t nInstance) :		// // //
 	m_pMixer(&Mixer),
@@ -49,3 +50,8 @@ CRegisterLogger &CSoundChip::GetRegisterLogger() const		// // //
 {
 	return *m_pRegisterLogger;
 }
+
+void CSoundChip::SerializeState(CStateArchive &ar)		// // //
+{
+	m_pRegisterLogger->SerializeState(ar);
+}
@@ -29,6 +29,7 @@
 
 class CMixer;
 class CRegisterLogger;		// // //
+class CStateArchive;		// // //
 
 class CSoundChip {
 public:
@@ -46,6 +47,8 @@ public:
 
 	virtual double	GetFreq(int Channel) const;		// // //
 
+	virtual void	SerializeState(CStateArchive &ar);		// // // overrides must call this first
+
 	virtual void	Log(uint16_t Address, uint8_t Value);		// // //
 	CRegisterLogger &GetRegisterLogger() const;		// // //
 
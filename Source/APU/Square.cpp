@@ -22,6 +22,9 @@
 
 #include "APU/Square.h"
 #include "APU/Mixer.h"		// // //
+#include <algorithm>		// // //
+#include <limits>		// // //
+#include "StateArchive.h"		// // //
 
 // This is also shared with MMC5
 
@@ -32,6 +35,14 @@ const uint8_t CSquare::DUTY_TABLE[4][16] = {
 	{1, 1, 0, 0,  0, 0, 1, 1,  1, 1, 1, 1,  1, 1, 1, 1},
 };
 
+// // // number of following duty steps that have the same value as the current one
+const uint8_t CSquare::DUTY_RUNS[4][16] = {
+	{1, 0, 1, 0, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2},
+	{1, 0, 3, 2,  1,  0, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2},
+	{1, 0, 7, 6,  5,  4,  3,  2,  1,  0,  7,  6,  5,  4,  3,  2},
+	{1, 0, 3, 2,  1,  0, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2},
+};
+
 CSquare::CSquare(CMixer &Mixer, std::uint8_t nInstance, sound_chip_t Chip, std::uint8_t subindex) :
 	C2A03Chan(Mixer, {nInstance, Chip, subindex})		// // //
 {
@@ -135,14 +146,20 @@ void CSquare::Process(uint32_t Time)
 
 	bool Valid = (m_iPeriod > 7 || (m_iPeriod > 0 && GetChannelType().Chip == sound_chip_t::MMC5))		// // //
 		&& (m_iEnabled != 0) && (m_iLengthCounter > 0) && (m_iSweepResult < 0x800);
+	uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
+	const uint32_t Period = m_iPeriod + 1;		// // //
 
 	while (Time >= m_iCounter) {
 		Time		-= m_iCounter;
 		m_iTime		+= m_iCounter;
-		m_iCounter	 = m_iPeriod + 1;
-		uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
+		m_iCounter	 = Period;
 		Mix(Valid && DUTY_TABLE[m_iDutyLength][m_iDutyCycle] ? Volume : 0);
-		m_iDutyCycle = (m_iDutyCycle + 1) & 0x0F;
+
+		// // // jump straight to the next period that changes the output
+		uint32_t Skip = std::min(Time / Period, GetStepsUntilChange(Valid && Volume));
+		Time	-= Skip * Period;
+		m_iTime += Skip * Period;
+		m_iDutyCycle = (m_iDutyCycle + 1 + Skip) & 0x0F;
 	}
 
 	m_iCounter -= Time;
@@ -158,6 +175,13 @@ double CSquare::GetFrequency() const		// // //
 	return CPU_RATE / 16. / (m_iPeriod + 1.);
 }
 
+uint32_t CSquare::GetStepsUntilChange(bool Audible) const		// // //
+{
+	if (!Audible)
+		return std::numeric_limits<uint32_t>::max();
+	return DUTY_RUNS[m_iDutyLength][m_iDutyCycle];
+}
+
 void CSquare::LengthCounterUpdate()
 {
 	if ((m_iLooping == 0) && (m_iLengthCounter > 0))
@@ -197,3 +221,11 @@ void CSquare::EnvelopeUpdate()
 		}
 	}
 }
+
+void CSquare::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iDutyLength, m_iDutyCycle,
+		m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed, m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter,
+		m_iSweepEnabled, m_iSweepPeriod, m_iSweepMode, m_iSweepShift, m_iSweepCounter, m_iSweepResult, m_bSweepWritten);
+}
@@ -41,13 +41,18 @@ public:
 	uint8_t	ReadControl();
 	void	Process(uint32_t Time);
 	double	GetFrequency() const;		// // //
+	void	SerializeState(CStateArchive &ar);		// // //
 
 	void	LengthCounterUpdate();
 	void	SweepUpdate(int Diff);
 	void	EnvelopeUpdate();
 
+private:
+	uint32_t GetStepsUntilChange(bool Audible) const;		// // //
+
 public:
 	static const uint8_t DUTY_TABLE[4][16];
+	static const uint8_t DUTY_RUNS[4][16];		// // //
 	uint32_t CPU_RATE;		// // //
 
 private:
@@ -22,6 +22,7 @@
 
 #include "APU/Triangle.h"
 #include "APU/Types.h"		// // //
+#include "StateArchive.h"		// // //
 
 const uint8_t CTriangle::TRIANGLE_WAVE[] = {
 	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
@@ -152,3 +153,9 @@ void CTriangle::LinearCounterUpdate()
 	if (m_iLoop == 0)
 		m_iHalt = 0;
 }
+
+void CTriangle::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iLoop, m_iLinearLoad, m_iHalt, m_iLinearCounter, m_iStepGen);
+}
@@ -0,0 +1,117 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "APU/Upsampler.h"
+#include "StateArchive.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double KAISER_BETA = 7.;		// about 70 dB of image rejection
+
+double BesselI0(double x) {
+	double Sum = 1., Term = 1.;
+	for (int k = 1; k < 32; ++k) {
+		Term *= (x / (2. * k)) * (x / (2. * k));
+		Sum += Term;
+	}
+	return Sum;
+}
+
+} // namespace
+
+void CUpsampler::SetFactor(unsigned Factor) {
+	factor_ = std::max(Factor, 1u);
+	kernel_.assign(factor_ * TAPS, 0.f);
+
+	// Kaiser-windowed sinc cut off at the input's half sampling rate; the input is
+	// already band-limited below it by the mixer's own filters
+	const std::size_t Length = factor_ * TAPS;
+	const double Center = (Length - 1) / 2.;
+	const double Norm = BesselI0(KAISER_BETA);
+	for (std::size_t n = 0; n < Length; ++n) {
+		double x = (n - Center) / factor_;
+		double Sinc = x == 0. ? 1. : std::sin(PI * x) / (PI * x);
+		double r = (n - Center) / Center;
+		double Window = BesselI0(KAISER_BETA * std::sqrt(std::max(0., 1. - r * r))) / Norm;
+		// output sample m * factor + p uses input m - k with coefficient n = k * factor + p
+		std::size_t k = n / factor_, p = n % factor_;
+		kernel_[p * TAPS + (TAPS - 1 - k)] = static_cast<float>(Sinc * Window);
+	}
+
+	// every phase sums to unity so that a constant input passes unchanged
+	for (unsigned p = 0; p < factor_; ++p) {
+		float *Phase = kernel_.data() + p * TAPS;
+		double Sum = 0.;
+		for (std::size_t i = 0; i < TAPS; ++i)
+			Sum += Phase[i];
+		for (std::size_t i = 0; i < TAPS; ++i)
+			Phase[i] = static_cast<float>(Phase[i] / Sum);
+	}
+
+	Clear();
+}
+
+unsigned CUpsampler::GetFactor() const {
+	return factor_;
+}
+
+void CUpsampler::Clear() {
+	history_.assign(TAPS - 1, 0.f);
+}
+
+void CUpsampler::SerializeState(CStateArchive &ar) {
+	ar(history_);
+}
+
+void CUpsampler::Process(const float *In, std::size_t Count, float *Out, std::size_t Step) {
+	ProcessImpl(In, Count, Out, Step);
+}
+
+void CUpsampler::Process(const float *In, std::size_t Count, int16_t *Out, std::size_t Step) {
+	ProcessImpl(In, Count, Out, Step);
+}
+
+template <typename T>
+void CUpsampler::ProcessImpl(const float *In, std::size_t Count, T *Out, std::size_t Step) {
+	history_.insert(history_.end(), In, In + Count);
+
+	for (std::size_t m = 0; m < Count; ++m) {
+		const float *Window = history_.data() + m;
+		for (unsigned p = 0; p < factor_; ++p) {
+			const float *Phase = kernel_.data() + p * TAPS;
+			float Sum = 0.f;
+			for (std::size_t i = 0; i < TAPS; ++i)
+				Sum += Window[i] * Phase[i];
+			if constexpr (std::is_same_v<T, float>)
+				*Out = Sum;
+			else		// same rounding and clipping as Blip_Buffer::read_samples
+				*Out = static_cast<T>(std::clamp(std::floor(Sum * 32768.f), -32768.f, 32767.f));
+			Out += Step;
+		}
+	}
+
+	history_.erase(history_.begin(), history_.end() - (TAPS - 1));
+}
@@ -0,0 +1,55 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CStateArchive;
+
+// // // polyphase interpolator that raises the sample rate by an integer factor,
+// used to render at high sample rates without changing how the chips are filtered
+class CUpsampler {
+public:
+	void SetFactor(unsigned Factor);
+	unsigned GetFactor() const;
+	void Clear();
+	void SerializeState(CStateArchive &ar);
+
+	// writes Count * factor samples, Step apart so that stereo output can be interleaved
+	void Process(const float *In, std::size_t Count, float *Out, std::size_t Step);
+	void Process(const float *In, std::size_t Count, int16_t *Out, std::size_t Step);
+
+private:
+	template <typename T>
+	void ProcessImpl(const float *In, std::size_t Count, T *Out, std::size_t Step);
+
+private:
+	static constexpr std::size_t TAPS = 32;		// input samples per output sample
+
+	unsigned factor_ = 1u;
+	std::vector<float> kernel_;			// one reversed set of TAPS coefficients per phase
+	std::vector<float> history_;		// last TAPS - 1 input samples, then the current input
+};
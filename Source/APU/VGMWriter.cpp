@@ -0,0 +1,248 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "APU/VGMWriter.h"
+#include "APU/Types.h"
+#include "SimpleFile.h"
+#include "ft0cc/doc/dpcm_sample.hpp"
+#include <algorithm>
+
+namespace {
+
+// VGM commands
+constexpr std::uint8_t CMD_YM2413 = 0x51u;
+constexpr std::uint8_t CMD_WAIT = 0x61u;
+constexpr std::uint8_t CMD_WAIT_NTSC = 0x62u;		// 735 samples
+constexpr std::uint8_t CMD_WAIT_PAL = 0x63u;		// 882 samples
+constexpr std::uint8_t CMD_END = 0x66u;
+constexpr std::uint8_t CMD_DATA_BLOCK = 0x67u;
+constexpr std::uint8_t CMD_WAIT_SHORT = 0x70u;		// 0x70 to 0x7F wait 1 to 16 samples
+constexpr std::uint8_t CMD_AY8910 = 0xA0u;
+constexpr std::uint8_t CMD_NES_APU = 0xB4u;
+
+constexpr std::uint8_t DATA_NES_APU_RAM = 0xC2u;
+
+constexpr std::uint32_t VERSION = 0x171u;
+constexpr std::uint32_t CLOCK_VRC7 = 3579545u;
+constexpr std::uint32_t FLAG_VRC7 = 0x80000000u;		// on the YM2413 clock
+constexpr std::uint32_t FLAG_FDS = 0x80000000u;		// on the NES APU clock
+constexpr std::uint8_t AY_TYPE_YM2149 = 0x10u;
+constexpr std::uint8_t AY_FLAG_LEGACY_OUTPUT = 0x01u;
+
+constexpr std::uint16_t DPCM_ADDRESS = 0xC000u;		// where CSampleMem maps samples
+
+void PutInt32(std::vector<std::uint8_t> &buf, std::size_t Pos, std::uint32_t x) {
+	buf[Pos] = static_cast<std::uint8_t>(x);
+	buf[Pos + 1] = static_cast<std::uint8_t>(x >> 8);
+	buf[Pos + 2] = static_cast<std::uint8_t>(x >> 16);
+	buf[Pos + 3] = static_cast<std::uint8_t>(x >> 24);
+}
+
+} // namespace
+
+CVGMWriter::CVGMWriter(std::shared_ptr<CSimpleFile> pFile) :
+	file_(std::move(pFile)), start_pos_(file_->GetPosition())
+{
+	// the header is filled in by Close
+	buf_.reserve(BUFFER_SIZE);
+	buf_.resize(HEADER_SIZE);
+}
+
+CVGMWriter::~CVGMWriter() noexcept {
+	Close();
+}
+
+void CVGMWriter::Close() {
+	if (!file_)
+		return;
+
+	PutWait();
+	buf_.push_back(CMD_END);
+	Flush();
+
+	std::vector<std::uint8_t> header(HEADER_SIZE);
+	std::copy_n("Vgm ", 4, header.begin());
+	PutInt32(header, 0x04, static_cast<std::uint32_t>(size_ - 0x04));
+	PutInt32(header, 0x08, VERSION);
+	PutInt32(header, 0x18, samples_);
+	PutInt32(header, 0x34, static_cast<std::uint32_t>(HEADER_SIZE - 0x34));
+
+	machine_t Machine = hasMachine_ ? machine_ : machine_t::NTSC;
+	std::uint32_t Clock = Machine == machine_t::PAL ? MASTER_CLOCK_PAL : MASTER_CLOCK_NTSC;
+	PutInt32(header, 0x24, Machine == machine_t::PAL ? 50u : 60u);
+	PutInt32(header, 0x84, Clock | (chips_.ContainsChip(sound_chip_t::FDS) ? FLAG_FDS : 0u));
+	if (chips_.ContainsChip(sound_chip_t::VRC7))
+		PutInt32(header, 0x10, CLOCK_VRC7 | FLAG_VRC7);
+	if (chips_.ContainsChip(sound_chip_t::S5B)) {
+		PutInt32(header, 0x74, Clock / 2);		// the 5B divides its input clock by 2
+		header[0x78] = AY_TYPE_YM2149;
+		header[0x79] = AY_FLAG_LEGACY_OUTPUT;
+	}
+
+	file_->Seek(start_pos_);
+	file_->WriteBytes(array_view<unsigned char> {header.data(), header.size()});
+	file_->Seek(start_pos_ + size_);
+	file_.reset();
+}
+
+void CVGMWriter::AddRun(std::uint32_t Cycles) {
+	remainder_ += static_cast<std::uint64_t>(Cycles) * SAMPLE_RATE;
+	std::uint32_t Clock = GetClockRate();
+	auto Samples = static_cast<std::uint32_t>(remainder_ / Clock);
+	remainder_ -= static_cast<std::uint64_t>(Samples) * Clock;
+	waiting_ += Samples;
+}
+
+void CVGMWriter::AddWrite(std::uint16_t Address, std::uint8_t Value) {
+	const bool FDS = chips_.ContainsChip(sound_chip_t::FDS);
+	const bool VRC7 = chips_.ContainsChip(sound_chip_t::VRC7);
+	const bool S5B = chips_.ContainsChip(sound_chip_t::S5B);
+
+	// registers 00-1F are $4000-$401F, 20-3E are $4080-$409E, 3F is $4023, 40-7F are $4040-$407F
+	if ((Address >= 0x4000 && Address <= 0x4013) || Address == 0x4015 || Address == 0x4017)
+		PutCommand(CMD_NES_APU, static_cast<std::uint8_t>(Address - 0x4000), Value);
+	else if (FDS && Address >= 0x4040 && Address <= 0x407F)
+		PutCommand(CMD_NES_APU, static_cast<std::uint8_t>(Address - 0x4000), Value);
+	else if (FDS && Address >= 0x4080 && Address <= 0x409E)
+		PutCommand(CMD_NES_APU, static_cast<std::uint8_t>(Address - 0x4060), Value);
+	else if (FDS && Address == 0x4023)
+		PutCommand(CMD_NES_APU, 0x3Fu, Value);
+	else if (VRC7 && Address == 0x9010)
+		vrc7Port_ = Value;
+	else if (VRC7 && Address == 0x9030)
+		PutCommand(CMD_YM2413, vrc7Port_, Value);
+	else if (S5B && Address == 0xC000)
+		s5bPort_ = Value & 0x0Fu;
+	else if (S5B && Address == 0xE000)
+		PutCommand(CMD_AY8910, s5bPort_, Value);
+}
+
+void CVGMWriter::AddRead(std::uint16_t Address) {
+}
+
+void CVGMWriter::AddEndFrame() {
+}
+
+// VGM has no reset command, the chips are silenced instead
+void CVGMWriter::AddReset() {
+	PutCommand(CMD_NES_APU, 0x15u, 0x00u);
+	PutCommand(CMD_NES_APU, 0x11u, 0x00u);
+	if (chips_.ContainsChip(sound_chip_t::FDS)) {
+		PutCommand(CMD_NES_APU, 0x20u, 0x80u);		// $4080
+		PutCommand(CMD_NES_APU, 0x23u, 0x80u);		// $4083
+	}
+	if (chips_.ContainsChip(sound_chip_t::VRC7))
+		for (std::uint8_t i = 0; i < 6; ++i)
+			PutCommand(CMD_YM2413, 0x20u + i, 0x00u);
+	if (chips_.ContainsChip(sound_chip_t::S5B)) {
+		PutCommand(CMD_AY8910, 0x07u, 0x3Fu);
+		for (std::uint8_t i = 0; i < 3; ++i)
+			PutCommand(CMD_AY8910, 0x08u + i, 0x00u);
+	}
+
+	// the APU clears its sample memory
+	sample_.reset();
+}
+
+// the player's RAM keeps the tail of a longer sample loaded before, so it is
+// cleared to match CSampleMem, which reads 0 past the end of a sample
+void CVGMWriter::AddSample(const std::shared_ptr<const ft0cc::doc::dpcm_sample> &pSample) {
+	if (!pSample || pSample == sample_)
+		return;
+	sample_ = pSample;
+
+	std::size_t Size = pSample->size();
+	std::size_t Extent = std::max(Size, sampleExtent_);
+	sampleExtent_ = Extent;
+
+	PutWait();
+	buf_.push_back(CMD_DATA_BLOCK);
+	buf_.push_back(CMD_END);		// compatibility byte
+	buf_.push_back(DATA_NES_APU_RAM);
+	std::size_t Pos = buf_.size();
+	buf_.resize(Pos + 4);
+	PutInt32(buf_, Pos, static_cast<std::uint32_t>(Extent + 2));
+	buf_.push_back(static_cast<std::uint8_t>(DPCM_ADDRESS));
+	buf_.push_back(static_cast<std::uint8_t>(DPCM_ADDRESS >> 8));
+	buf_.insert(buf_.end(), pSample->data(), pSample->data() + Size);
+	buf_.resize(buf_.size() + Extent - Size);
+	if (buf_.size() >= BUFFER_SIZE)
+		Flush();
+}
+
+void CVGMWriter::AddMachine(machine_t Machine) {
+	machine_ = Machine;
+	hasMachine_ = true;
+}
+
+void CVGMWriter::AddChips(CSoundChipSet Chips) {
+	chips_ = chips_.MergedWith(Chips);
+}
+
+std::uint32_t CVGMWriter::GetSampleCount() const {
+	return samples_ + waiting_;
+}
+
+CSoundChipSet CVGMWriter::GetUnsupportedChips() const {
+	return chips_.WithoutChip(sound_chip_t::APU).WithoutChip(sound_chip_t::FDS)
+		.WithoutChip(sound_chip_t::VRC7).WithoutChip(sound_chip_t::S5B);
+}
+
+void CVGMWriter::PutWait() {
+	samples_ += waiting_;
+	while (waiting_) {
+		if (waiting_ <= 16u) {
+			buf_.push_back(static_cast<std::uint8_t>(CMD_WAIT_SHORT + waiting_ - 1));
+			waiting_ = 0u;
+		}
+		else if (waiting_ == 735u || waiting_ == 882u) {
+			buf_.push_back(waiting_ == 735u ? CMD_WAIT_NTSC : CMD_WAIT_PAL);
+			waiting_ = 0u;
+		}
+		else {
+			std::uint32_t n = std::min(waiting_, 0xFFFFu);
+			buf_.push_back(CMD_WAIT);
+			buf_.push_back(static_cast<std::uint8_t>(n));
+			buf_.push_back(static_cast<std::uint8_t>(n >> 8));
+			waiting_ -= n;
+		}
+	}
+}
+
+void CVGMWriter::PutCommand(std::uint8_t Command, std::uint8_t Reg, std::uint8_t Value) {
+	PutWait();
+	buf_.push_back(Command);
+	buf_.push_back(Reg);
+	buf_.push_back(Value);
+	if (buf_.size() >= BUFFER_SIZE)
+		Flush();
+}
+
+void CVGMWriter::Flush() {
+	file_->WriteBytes(array_view<unsigned char> {buf_.data(), buf_.size()});
+	size_ += buf_.size();
+	buf_.clear();
+}
+
+std::uint32_t CVGMWriter::GetClockRate() const {
+	return machine_ == machine_t::PAL ? MASTER_CLOCK_PAL : MASTER_CLOCK_NTSC;
+}
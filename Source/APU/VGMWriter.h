@@ -0,0 +1,86 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "APU/Types_fwd.h"
+#include "APU/RegisterListener.h"
+#include "SoundChipSet.h"
+
+class CSimpleFile;
+
+// // // streams the writes to the chips that VGM supports (2A03, FDS, VRC7 and
+// 5B) into a VGM 1.71 file as they happen; commands are buffered in blocks of
+// BUFFER_SIZE bytes, and the header is written when the stream is closed
+class CVGMWriter : public CRegisterListener {
+public:
+	static constexpr std::uint32_t SAMPLE_RATE = 44100u;		// VGM time base
+	static constexpr std::size_t HEADER_SIZE = 0x100u;
+	static constexpr std::size_t BUFFER_SIZE = 0x10000u;
+
+	explicit CVGMWriter(std::shared_ptr<CSimpleFile> pFile);
+	~CVGMWriter() noexcept;
+
+	void Close();		// ends the stream and writes the header, the writer is unusable afterwards
+
+	void AddRun(std::uint32_t Cycles) override;
+	void AddWrite(std::uint16_t Address, std::uint8_t Value) override;
+	void AddRead(std::uint16_t Address) override;
+	void AddEndFrame() override;
+	void AddReset() override;
+	void AddSample(const std::shared_ptr<const ft0cc::doc::dpcm_sample> &pSample) override;
+	void AddMachine(machine_t Machine) override;
+	void AddChips(CSoundChipSet Chips) override;
+
+	std::uint32_t GetSampleCount() const;
+	CSoundChipSet GetUnsupportedChips() const;		// chips whose writes are left out
+
+private:
+	void PutWait();
+	void PutCommand(std::uint8_t Command, std::uint8_t Reg, std::uint8_t Value);
+	void Flush();
+	std::uint32_t GetClockRate() const;
+
+private:
+	std::shared_ptr<CSimpleFile> file_;
+	std::size_t start_pos_ = 0u;
+	std::size_t size_ = 0u;		// bytes written after the header
+	std::vector<std::uint8_t> buf_;
+
+	machine_t machine_ { };
+	bool hasMachine_ = false;
+	CSoundChipSet chips_;
+
+	std::uint64_t remainder_ = 0u;		// elapsed time not yet converted to samples, in units of 1 / (SAMPLE_RATE * clock rate) s
+	std::uint32_t waiting_ = 0u;		// samples elapsed since the last command
+	std::uint32_t samples_ = 0u;
+
+	std::uint8_t vrc7Port_ = 0u;
+	std::uint8_t s5bPort_ = 0u;
+	std::shared_ptr<const ft0cc::doc::dpcm_sample> sample_;		// the sample in the player's RAM
+	std::size_t sampleExtent_ = 0u;		// bytes of RAM written by earlier samples
+};
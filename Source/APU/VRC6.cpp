@@ -23,6 +23,9 @@
 #include "APU/VRC6.h"
 #include "APU/Types.h"		// // //
 #include "RegisterState.h"		// // //
+#include <algorithm>		// // //
+#include <limits>		// // //
+#include "StateArchive.h"		// // //
 
 // Konami VRC6 external sound chip emulation
 
@@ -79,12 +82,27 @@ void CVRC6_Pulse::Process(int Time)
 
 		m_iDutyCycleCounter = (m_iDutyCycleCounter + 1) & 0x0F;
 		Mix((m_iGate || m_iDutyCycleCounter >= m_iDutyCycle) ? m_iVolume : 0);
+
+		// // // jump straight to the next period that changes the output
+		int Skip = std::min(Time / m_iCounter, GetStepsUntilChange());
+		Time	-= Skip * m_iCounter;
+		m_iTime += Skip * m_iCounter;
+		m_iDutyCycleCounter = (m_iDutyCycleCounter + Skip) & 0x0F;
 	}
 
 	m_iCounter -= Time;
 	m_iTime += Time;
 }
 
+int CVRC6_Pulse::GetStepsUntilChange() const		// // //
+{
+	if (m_iGate || !m_iVolume)
+		return std::numeric_limits<int>::max();
+	if (m_iDutyCycleCounter >= m_iDutyCycle)
+		return 15 - m_iDutyCycleCounter;
+	return m_iDutyCycle - 1 - m_iDutyCycleCounter;
+}
+
 double CVRC6_Pulse::GetFrequency() const		// // //
 {
 	if (m_iGate || !m_iEnabled || !m_iPeriod)
@@ -151,6 +169,13 @@ void CVRC6_Sawtooth::Process(int Time)
 
 		// The 5 highest bits of accumulator are sent to the mixer
 		Mix(m_iPhaseAccumulator >> 3);
+
+		if (!m_iPhaseInput && !m_iPhaseAccumulator) {		// // // output stays at 0
+			int Skip = Time / m_iCounter;
+			Time	-= Skip * m_iCounter;
+			m_iTime += Skip * m_iCounter;
+			m_iResetReg = (m_iResetReg + Skip) % 14;
+		}
 	}
 
 	m_iCounter -= Time;
@@ -236,3 +261,23 @@ double CVRC6::GetFreq(int Channel) const		// // //
 	}
 	return 0.;
 }
+
+void CVRC6::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+	ar(m_Pulse1, m_Pulse2, m_Sawtooth);
+}
+
+void CVRC6_Pulse::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iDutyCycle, m_iVolume, m_iGate, m_iEnabled, m_iPeriod, m_iPeriodLow, m_iPeriodHigh,
+		m_iCounter, m_iDutyCycleCounter);
+}
+
+void CVRC6_Sawtooth::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iPhaseAccumulator, m_iPhaseInput, m_iEnabled, m_iResetReg, m_iPeriod, m_iPeriodLow, m_iPeriodHigh,
+		m_iCounter);
+}
@@ -33,6 +33,10 @@ public:
 	void Write(uint16_t Address, uint8_t Value);
 	void Process(int Time);
 	double GetFrequency() const;		// // //
+	void SerializeState(CStateArchive &ar);		// // //
+
+private:
+	int GetStepsUntilChange() const;		// // //
 
 private:
 	uint8_t	m_iDutyCycle,
@@ -53,6 +57,7 @@ public:
 	void Write(uint16_t Address, uint8_t Value);
 	void Process(int Time);
 	double GetFrequency() const;		// // //
+	void SerializeState(CStateArchive &ar);		// // //
 
 private:
 	uint8_t	m_iPhaseAccumulator,
@@ -79,6 +84,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped) override;
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	CVRC6_Pulse	m_Pulse1;		// // //
@@ -23,9 +23,12 @@
 #include "APU/VRC7.h"
 #include "APU/Mixer.h"		// // //
 #include "RegisterState.h"		// // //
+#include "StateArchive.h"		// // //
+#include <vector>		// // //
 
 const float  CVRC7::AMPLIFY	  = 4.6f;		// Mixing amplification, VRC7 patch 14 is 4,88 times stronger than a 50% square @ v=15
 const uint32_t CVRC7::OPL_CLOCK = 3579545;	// Clock frequency
+const uint32_t CVRC7::OPL_RATE = 49716;		// // // Native sample rate, OPL_CLOCK / 72
 
 CVRC7::CVRC7(CMixer &Mixer, std::uint8_t nInstance) : CSoundChip(Mixer, nInstance)
 {
@@ -33,6 +36,8 @@ CVRC7::CVRC7(CMixer &Mixer, std::uint8_t nInstance) : CSoundChip(Mixer, nInstanc
 	m_pRegisterLogger->AddRegisterRange(0x10, 0x15);
 	m_pRegisterLogger->AddRegisterRange(0x20, 0x25);
 	m_pRegisterLogger->AddRegisterRange(0x30, 0x35);
+	m_fPanLeft.fill(1.);		// // // centered
+	m_fPanRight.fill(1.);
 	Reset();
 }
 
@@ -42,20 +47,24 @@ sound_chip_t CVRC7::GetID() const {		// // //
 
 void CVRC7::Reset()
 {
-	m_iBufferPtr = 0;
 	m_iTime = 0;
+	m_iNextSample = 0;		// // //
+	m_iLastSample = 0;		// // //
+	m_iLastSampleRight = 0;		// // //
+	m_iStemLastSample.fill(0);		// // //
 }
 
-void CVRC7::SetSampleSpeed(uint32_t SampleRate, double ClockRate, uint32_t FrameRate)
+void CVRC7::SetClockRate(uint32_t ClockRate)		// // //
 {
-	m_pOPLLInt.reset(OPLL_new(OPL_CLOCK, SampleRate));		// // //
+	[[maybe_unused]] static const bool TablesReady = (OPLL_init_tables(), true);		// // // shared, built only once
+
+	// // // the OPLL runs at its own rate, the mixer resamples it like every other chip
+	m_pOPLLInt.reset(OPLL_new(OPL_CLOCK, OPL_RATE));
 
 	OPLL_reset(m_pOPLLInt.get());
 	OPLL_reset_patch(m_pOPLLInt.get(), 1);
 
-	m_iMaxSamples = (SampleRate / FrameRate) * 2;	// Allow some overflow
-
-	m_iBuffer = std::vector<int16_t>(m_iMaxSamples);		// // //
+	m_iSamplePeriod = static_cast<uint64_t>(72. * ClockRate / OPL_CLOCK * 65536. + .5);
 }
 
 void CVRC7::SetVolume(float Volume)
@@ -90,44 +99,127 @@ uint8_t CVRC7::Read(uint16_t Address, bool &Mapped)
 
 void CVRC7::EndFrame()
 {
-	uint32_t WantSamples = m_pMixer->GetMixSampleCount(m_iTime);
+	// // // samples were already rendered in Process, the next one may fall into the next frame
+	m_iNextSample -= static_cast<uint64_t>(m_iTime) << 16;
+	m_iTime = 0;
 
-	static int32_t LastSample = 0;
+	if (!m_pOPLLInt)		// // //
+		return;
 
-	// Generate VRC7 samples
-	while (m_iBufferPtr < WantSamples) {
-		int32_t RawSample = OPLL_calc(m_pOPLLInt.get());
+	// Get channel levels
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)		// // //
+		m_pMixer->StoreChannelLevel(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)},
+			OPLL_getchanvol(m_pOPLLInt.get(), i));
+}
 
-		// Clipping is slightly asymmetric
-		if (RawSample > 3600)
-			RawSample = 3600;
-		if (RawSample < -3200)
-			RawSample = -3200;
+int32_t CVRC7::ScaleSample(int32_t RawSample) const		// // //
+{
+	// Clipping is slightly asymmetric
+	if (RawSample > 3600)
+		RawSample = 3600;
+	if (RawSample < -3200)
+		RawSample = -3200;
+
+	// Apply volume
+	// // // not saturated to 16 bits, the mixer clips the whole output if it has to
+	return int(float(RawSample) * m_fVolume);
+}
+
+void CVRC7::RenderSample(uint32_t Time)		// // //
+{
+	if (m_bStereo)
+		return RenderStereoSample(Time);
 
-		// Apply volume
-		int32_t Sample = int(float(RawSample) * m_fVolume);
+	int32_t Sample = ScaleSample(OPLL_calc(m_pOPLLInt.get()));
+	if (Sample != m_iLastSample) {
+		m_pMixer->AddVRC7Value(Sample - m_iLastSample, 0, Time);
+		m_iLastSample = Sample;
+	}
 
-		if (Sample > 32767)
-			Sample = 32767;
-		if (Sample < -32768)
-			Sample = -32768;
+	if (m_iStemMask)
+		RenderStems(Time);
+}
 
-		m_iBuffer[m_iBufferPtr++] = int16_t((Sample + LastSample) >> 1);
-		LastSample = Sample;
+void CVRC7::RenderStereoSample(uint32_t Time)		// // //
+{
+	OPLL_calc(m_pOPLLInt.get());
+	const int16_t *Out = m_pOPLLInt->ch_out;
+
+	// weighted copy of the mono sum, which wraps around in the same way; the rhythm channels stay centered
+	double Left = 0., Right = 0.;
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i) {
+		Left += Out[i] * m_fPanLeft[i];
+		Right += Out[i] * m_fPanRight[i];
+	}
+	int32_t Rest = 0;
+	for (std::size_t i = MAX_CHANNELS_VRC7; i < std::size(m_pOPLLInt->ch_out); ++i)
+		Rest += Out[i];
+
+	int32_t SampleL = ScaleSample(static_cast<int16_t>(static_cast<int32_t>(Left) + Rest));
+	int32_t SampleR = ScaleSample(static_cast<int16_t>(static_cast<int32_t>(Right) + Rest));
+	if (SampleL != m_iLastSample || SampleR != m_iLastSampleRight) {
+		m_pMixer->AddVRC7Value(SampleL - m_iLastSample, SampleR - m_iLastSampleRight, Time);
+		m_iLastSample = SampleL;
+		m_iLastSampleRight = SampleR;
 	}
 
-	m_pMixer->MixSamples((blip_sample_t*)m_iBuffer.data(), WantSamples);		// // //
+	if (m_iStemMask)
+		RenderStems(Time);
+}
 
-	m_iBufferPtr -= WantSamples;
-	m_iTime = 0;
+void CVRC7::RenderStems(uint32_t Time)		// // //
+{
+	// each channel is clipped on its own, as if the others were silent
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i) {
+		if (!(m_iStemMask & (1 << i)))
+			continue;
+		int32_t Sample = ScaleSample(m_pOPLLInt->ch_out[i]);
+		if (Sample != m_iStemLastSample[i]) {
+			m_pMixer->AddVRC7StemValue(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)},
+				Sample - m_iStemLastSample[i], Time);
+			m_iStemLastSample[i] = Sample;
+		}
+	}
 }
 
 void CVRC7::Process(uint32_t Time)
 {
-	// This cannot run in sync, fetch all samples at end of frame instead
+	// // // Render every OPLL sample at its own cycle, so that register writes line up with the other chips
+	if (!m_pOPLLInt) {
+		m_iTime += Time;
+		return;
+	}
+
+	const uint64_t End = static_cast<uint64_t>(m_iTime + Time) << 16;
+	while (m_iNextSample < End) {
+		RenderSample(static_cast<uint32_t>(m_iNextSample >> 16));
+		m_iNextSample += m_iSamplePeriod;
+	}
+
 	m_iTime += Time;
 }
 
+void CVRC7::SetStemChannels(const std::vector<stChannelID> &Channels)		// // //
+{
+	m_iStemMask = 0;
+	for (stChannelID ch : Channels)
+		if (ch.Chip == sound_chip_t::VRC7 && ch.Subindex < MAX_CHANNELS_VRC7)
+			m_iStemMask |= 1 << ch.Subindex;
+}
+
+void CVRC7::SetStereo(bool Stereo)		// // //
+{
+	m_bStereo = Stereo;
+}
+
+void CVRC7::SetChannelPan(std::uint8_t Subindex, double Left, double Right)		// // //
+{
+	if (Subindex < MAX_CHANNELS_VRC7) {
+		m_fPanLeft[Subindex] = Left;
+		m_fPanRight[Subindex] = Right;
+	}
+}
+
 double CVRC7::GetFreq(int Channel) const		// // //
 {
 	if (Channel < 0 || Channel >= 6) return 0.;
@@ -137,3 +229,18 @@ double CVRC7::GetFreq(int Channel) const		// // //
 	Hi >>= 1;
 	return 49716. * Lo / (1 << (19 - Hi));
 }
+
+void CVRC7::SerializeState(CStateArchive &ar)		// // //
+{
+	CSoundChip::SerializeState(ar);
+
+	// the rate tables are left alone, they only depend on the clock rate
+	std::vector<uint8_t> opll(OPLL_state_size());
+	if (!ar.IsLoading())
+		OPLL_save_state(m_pOPLLInt.get(), opll.data());
+	ar(opll);
+	if (ar.IsLoading())
+		OPLL_load_state(m_pOPLLInt.get(), opll.data());
+
+	ar(m_iTime, m_iNextSample, m_iLastSample, m_iLastSampleRight, m_iStemLastSample, m_iSoundReg);
+}
@@ -24,7 +24,10 @@
 #pragma once
 
 #include "APU/SoundChip.h"
+#include "APU/Types.h"		// // //
 #include "APU/ext/emu2413.h"		// // //
+#include "Common.h"		// // //
+#include <array>		// // //
 #include <vector>		// // //
 
 struct OPLL_deleter {
@@ -39,8 +42,11 @@ public:
 
 	sound_chip_t GetID() const override;		// // //
 
-	void SetSampleSpeed(uint32_t SampleRate, double ClockRate, uint32_t FrameRate);
+	void SetClockRate(uint32_t ClockRate);		// // //
 	void SetVolume(float Volume);
+	void SetStemChannels(const std::vector<stChannelID> &Channels);		// // // same list as the mixer's
+	void SetStereo(bool Stereo);		// // //
+	void SetChannelPan(std::uint8_t Subindex, double Left, double Right);		// // // gains from CMixer::GetPanGains
 
 	void Reset() override;
 	void Process(uint32_t Time) override;
@@ -52,18 +58,34 @@ public:
 	void Log(uint16_t Address, uint8_t Value) override;		// // //
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
+
+private:
+	int32_t ScaleSample(int32_t RawSample) const;		// // //
+	void RenderSample(uint32_t Time);		// // //
+	void RenderStereoSample(uint32_t Time);		// // //
+	void RenderStems(uint32_t Time);		// // //
 
 protected:
 	static const float  AMPLIFY;
 	static const uint32_t OPL_CLOCK;
+	static const uint32_t OPL_RATE;		// // //
 
 private:
 	std::unique_ptr<OPLL, OPLL_deleter> m_pOPLLInt;		// // //
-	uint32_t	m_iTime;
+	uint32_t	m_iTime = 0;
+
+	uint64_t	m_iNextSample = 0;		// // // cycle of the next OPLL sample, 16.16 fixed point
+	uint64_t	m_iSamplePeriod = 0;		// // // cycles per OPLL sample, 16.16 fixed point
+	int32_t		m_iLastSample = 0;		// // //
+	int32_t		m_iLastSampleRight = 0;		// // //
+
+	bool		m_bStereo = false;		// // // cached from the mixer by CAPU
+	std::array<double, MAX_CHANNELS_VRC7> m_fPanLeft = { };		// // //
+	std::array<double, MAX_CHANNELS_VRC7> m_fPanRight = { };		// // //
 
-	uint32_t	m_iMaxSamples = 0;
-	std::vector<int16_t> m_iBuffer;		// // //
-	uint32_t	m_iBufferPtr;
+	uint8_t		m_iStemMask = 0;		// // // channels that have a stem, see SetStemChannels
+	std::array<int32_t, MAX_CHANNELS_VRC7> m_iStemLastSample = { };		// // //
 
 	float		m_fVolume = 1.f;
 
@@ -24,6 +24,7 @@
 #include "APU/Types.h"
 #include <cstring>
 #include <cmath>
+#include <algorithm>		// // //
 
 namespace xgm {
 
@@ -183,40 +184,8 @@ void NES_FDS::Tick (uint32_t clocks)
     // clock the wav table
     if (!wav_halt)
     {
-        // complex mod calculation
-        int32_t mod = 0;
-        if (env_out[EMOD] != 0) // skip if modulator off
-        {
-            // convert mod_pos to 7-bit signed
-            int32_t pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
-
-            // multiply pos by gain,
-            // shift off 4 bits but with odd "rounding" behaviour
-            int32_t temp = pos * env_out[EMOD];
-            int32_t rem = temp & 0x0F;
-            temp >>= 4;
-            if ((rem > 0) && ((temp & 0x80) == 0))
-            {
-                if (pos < 0) temp -= 1;
-                else         temp += 2;
-            }
-
-            // wrap if range is exceeded
-            while (temp >= 192) temp -= 256;
-            while (temp <  -64) temp += 256;
-
-            // multiply result by pitch,
-            // shift off 6 bits, round to nearest
-            temp = freq[TWAV] * temp;
-            rem = temp & 0x3F;
-            temp >>= 6;
-            if (rem >= 32) temp += 1;
-
-            mod = temp;
-        }
-
         // advance wavetable position
-        int32_t f = freq[TWAV] + mod;
+        int32_t f = freq[TWAV] + CalcMod();		// // //
         phase[TWAV] = phase[TWAV] + (clocks * f);
         phase[TWAV] = phase[TWAV] & 0x3FFFFF; // wrap
 
@@ -242,7 +211,41 @@ void NES_FDS::Tick (uint32_t clocks)
     last_vol = vol_out;
 }
 
-int32_t NES_FDS::Render ()		// // //
+int32_t NES_FDS::CalcMod () const		// // //
+{
+    // complex mod calculation
+    if (env_out[EMOD] == 0) // skip if modulator off
+        return 0;
+
+    // convert mod_pos to 7-bit signed
+    int32_t pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
+
+    // multiply pos by gain,
+    // shift off 4 bits but with odd "rounding" behaviour
+    int32_t temp = pos * env_out[EMOD];
+    int32_t rem = temp & 0x0F;
+    temp >>= 4;
+    if ((rem > 0) && ((temp & 0x80) == 0))
+    {
+        if (pos < 0) temp -= 1;
+        else         temp += 2;
+    }
+
+    // wrap if range is exceeded
+    while (temp >= 192) temp -= 256;
+    while (temp <  -64) temp += 256;
+
+    // multiply result by pitch,
+    // shift off 6 bits, round to nearest
+    temp = freq[TWAV] * temp;
+    rem = temp & 0x3F;
+    temp >>= 6;
+    if (rem >= 32) temp += 1;
+
+    return temp;
+}
+
+int32_t NES_FDS::MasterOutput () const		// // //
 {
     // 8 bit approximation of master volume
     const double MASTER_VOL = 2.4 * 1223.0; // max FDS vol vs max APU square (arbitrarily 1223)
@@ -253,7 +256,12 @@ int32_t NES_FDS::Render ()		// // //
         int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 4.0f),
         int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 5.0f) };
 
-    int32_t v = fout * MASTER[master_vol] >> 8;
+    return fout * MASTER[master_vol] >> 8;
+}
+
+int32_t NES_FDS::Render ()		// // //
+{
+    int32_t v = MasterOutput();
 
     // lowpass RC filter
     int32_t rc_out = ((rc_accum * rc_k) + (v * rc_l)) >> RC_BITS;
@@ -261,6 +269,113 @@ int32_t NES_FDS::Render ()		// // //
     return rc_out;		// // //
 }
 
+// // // Performs up to count calls of Tick(clocks) followed by Render(), but
+// only as long as the result of Render() provably stays the same; returns
+// the number of ticks actually skipped. The caller must have called Tick and
+// Render with the same clock count right before.
+uint32_t NES_FDS::SkipIdle (uint32_t clocks, uint32_t count)
+{
+    if (!clocks || !count)
+        return 0;
+
+    // the lowpass filter must have settled
+    if ((((rc_accum * rc_k) + (MasterOutput() * rc_l)) >> RC_BITS) != rc_accum)
+        return 0;
+
+    uint32_t ticks = count;
+
+    // envelopes may only clock if that does not change their outputs
+    const bool env_run = !env_halt && !wav_halt && (master_env_speed != 0);
+    uint32_t period[2] = { };
+    if (env_run)
+    {
+        for (int i=0; i<2; ++i)
+        {
+            if (env_disable[i])
+                continue;
+            period[i] = ((env_speed[i]+1) * master_env_speed) << 3;
+            bool saturated = env_mode[i] ? (env_out[i] >= 32) : (env_out[i] == 0);
+            if (!saturated)
+            {
+                // ticks before the one that clocks the envelope
+                uint32_t left = env_timer[i] >= period[i] ? 0 : (period[i] - env_timer[i] - 1) / clocks;
+                ticks = std::min(ticks, left);
+            }
+        }
+    }
+
+    // the modulator must not change the wave frequency
+    const bool mod_used = !wav_halt && (env_out[EMOD] != 0);
+    if (!mod_halt && mod_used)
+        return 0;
+
+    // the wave position must stay within samples of the same value
+    int32_t f = 0;
+    if (!wav_halt)
+    {
+        f = freq[TWAV] + CalcMod();
+        int32_t vol_out = std::min<uint32_t>(env_out[EVOL], 32);
+        if (!wav_write && vol_out != 0 && f != 0)
+        {
+            if (f < 0)
+                return 0;
+            uint32_t pos = phase[TWAV] >> 16;
+            int32_t wv = wave[TWAV][pos & 0x3F];
+            uint32_t run = 1;
+            while (run < 64 && wave[TWAV][(pos + run) & 0x3F] == wv)
+                ++run;
+            if (run < 64)
+            {
+                uint32_t dist = ((pos + run) << 16) - phase[TWAV];
+                uint32_t step = clocks * f;
+                ticks = std::min(ticks, (dist - 1) / step);
+            }
+        }
+    }
+
+    if (!ticks)
+        return 0;
+
+    // advance everything as if Tick had been called that many times
+    if (env_run)
+    {
+        for (int i=0; i<2; ++i)
+            if (!env_disable[i])
+            {
+                uint64_t timer = env_timer[i] + uint64_t(clocks) * ticks;
+                env_timer[i] = timer >= period[i] ? uint32_t(timer % period[i]) : uint32_t(timer);
+            }
+    }
+
+    if (!mod_halt)
+    {
+        uint32_t start_pos = phase[TMOD] >> 16;
+        phase[TMOD] += (clocks * ticks * freq[TMOD]);
+        uint32_t end_pos = phase[TMOD] >> 16;
+        phase[TMOD] = phase[TMOD] & 0x3FFFFF;
+        for (uint32_t p = start_pos; p < end_pos; ++p)
+        {
+            int32_t wv = wave[TMOD][p & 0x3F];
+            if (wv == 4)
+                mod_pos = 0;
+            else
+            {
+                const int32_t BIAS[8] = { 0, 1, 2, 4, 0, -4, -2, -1 };
+                mod_pos += BIAS[wv];
+                mod_pos &= 0x7F;
+            }
+        }
+    }
+
+    if (!wav_halt)
+    {
+        phase[TWAV] = (phase[TWAV] + clocks * ticks * f) & 0x3FFFFF;
+        last_freq = f;
+    }
+
+    return ticks;
+}
+
 bool NES_FDS::Write (uint32_t adr, uint32_t val)
 {
     // $4023 master I/O enable/disable
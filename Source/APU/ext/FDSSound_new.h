@@ -78,6 +78,9 @@ protected:
     int32_t rc_k;
     int32_t rc_l;
 
+    int32_t CalcMod () const;		// // //
+    int32_t MasterOutput () const;		// // //
+
 public:
     NES_FDS ();
     ~ NES_FDS ();
@@ -85,11 +88,21 @@ public:
     void Reset ();
     void Tick (uint32_t clocks);
     int32_t Render ();		// // //
+    uint32_t SkipIdle (uint32_t clocks, uint32_t count);		// // //
     bool Write (uint32_t adr, uint32_t val);
     bool Read (uint32_t adr, uint32_t & val);
     void SetRate (double);
     void SetClock (double);
     void SetOption (int, int);
+
+    // // // everything that changes while playing; rate, clock, options and the
+    // filter coefficients are configuration
+    template <typename Archive>
+    void SerializeState (Archive &ar) {
+        ar(fout, master_io, master_vol, last_freq, last_vol,
+            wave, freq, phase, wav_write, wav_halt, env_halt, mod_halt, mod_pos, mod_write_pos,
+            env_mode, env_disable, env_timer, env_speed, env_out, master_env_speed, rc_accum);
+    }
 };
 
 } // namespace xgm
@@ -72,10 +72,16 @@ SOFTWARE.
 
 **************************************************************************************/
 #include <stdlib.h>
+#include <stddef.h>		// // //
 #include <string.h>
 #include <math.h>
 #include "APU/ext/emu2413.h"		// // //
 
+#if !defined(EMU2413_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))		// // //
+#define EMU2413_SSE2
+#include <emmintrin.h>
+#endif
+
 #define OPLL_TONE_NUM 1
 static uint8_t default_inst[OPLL_TONE_NUM][(16 + 3) * 16] = {
   {
@@ -162,18 +168,13 @@ static uint8_t default_inst[OPLL_TONE_NUM][(16 + 3) * 16] = {
 #define EXPAND_BITS_X(x,s,d) (((x)<<((d)-(s)))|((1<<((d)-(s)))-1))
 
 /* Adjust envelope speed which depends on sampling rate. */
-#define RATE_ADJUST(x) (rate==49716?x:(uint32_t)((double)(x)*clk/72/rate + 0.5)) /* added 0.5 to round the value*/
+#define RATE_ADJUST(rt,x) ((rt)->rate==49716?x:(uint32_t)((double)(x)*(rt)->clk/72/(rt)->rate + 0.5)) /* added 0.5 to round the value*/
 
 #define MOD(o,x) (&(o)->slot[(x)<<1])
 #define CAR(o,x) (&(o)->slot[((x)<<1)|1])
 
 #define BIT(s,b) (((s)>>(b))&1)
 
-/* Input clock */
-static uint32_t clk = 844451141;
-/* Sampling rate */
-static uint32_t rate = 3354932;
-
 /* WaveTable for each envelope amp */
 static uint16_t fullsintable[PG_WIDTH];
 static uint16_t halfsintable[PG_WIDTH];
@@ -184,10 +185,6 @@ static uint16_t *waveform[2] = { fullsintable, halfsintable };
 static int32_t pmtable[PM_PG_WIDTH];
 static int32_t amtable[AM_PG_WIDTH];
 
-/* Phase delta for LFO */
-static uint32_t pm_dphase;
-static uint32_t am_dphase;
-
 /* dB to Liner table */
 static int16_t DB2LIN_TABLE[(DB_MUTE + DB_MUTE) * 2];
 
@@ -204,21 +201,10 @@ static OPLL_PATCH default_patch[OPLL_TONE_NUM][(16 + 3) * 2];
 enum OPLL_EG_STATE
 { READY, ATTACK, DECAY, SUSHOLD, SUSTINE, RELEASE, SETTLE, FINISH };
 
-/* Phase incr table for Attack */
-static uint32_t dphaseARTable[16][16];
-/* Phase incr table for Decay and Release */
-static uint32_t dphaseDRTable[16][16];
-
 /* KSL + TL Table */
 static uint32_t tllTable[16][8][1 << TL_BITS][4];
 static int32_t rksTable[2][8][2];
 
-/* Phase incr table for PG */
-static uint32_t dphaseTable[512][8][16];
-
-// Added by jsr
-int16_t opll_volumes[10];		// // //
-
 /***************************************************
 
                   Create tables
@@ -329,7 +315,7 @@ makeAmTable (void)
 
 /* Phase increment counter table */
 static void
-makeDphaseTable (void)
+makeDphaseTable (OPLL_RATE *rt)
 {
   uint32_t fnum, block, ML;
   uint32_t mltable[16] =
@@ -338,7 +324,7 @@ makeDphaseTable (void)
   for (fnum = 0; fnum < 512; fnum++)
     for (block = 0; block < 8; block++)
       for (ML = 0; ML < 16; ML++)
-        dphaseTable[fnum][block][ML] = RATE_ADJUST (((fnum * mltable[ML]) << block) >> (20 - DP_BITS));
+        rt->dphaseTable[fnum][block][ML] = RATE_ADJUST (rt, ((fnum * mltable[ML]) << block) >> (20 - DP_BITS));
 }
 
 static void
@@ -376,7 +362,7 @@ makeTllTable (void)
 
 /* Rate Table for Attack */
 static void
-makeDphaseARTable (void)
+makeDphaseARTable (OPLL_RATE *rt)
 {
   int32_t AR, Rks, RM, RL;
 
@@ -390,13 +376,13 @@ makeDphaseARTable (void)
       switch (AR)
       {
       case 0:
-        dphaseARTable[AR][Rks] = 0;
+        rt->dphaseARTable[AR][Rks] = 0;
         break;
       case 15:
-        dphaseARTable[AR][Rks] = 0;/*EG_DP_WIDTH;*/
+        rt->dphaseARTable[AR][Rks] = 0;/*EG_DP_WIDTH;*/
         break;
       default:
-        dphaseARTable[AR][Rks] = RATE_ADJUST ((3 * (RL + 4) << (RM + 1)));
+        rt->dphaseARTable[AR][Rks] = RATE_ADJUST (rt, (3 * (RL + 4) << (RM + 1)));
         break;
       }
     }
@@ -404,7 +390,7 @@ makeDphaseARTable (void)
 
 /* Rate Table for Decay and Release */
 static void
-makeDphaseDRTable (void)
+makeDphaseDRTable (OPLL_RATE *rt)
 {
   int32_t DR, Rks, RM, RL;
 
@@ -418,10 +404,10 @@ makeDphaseDRTable (void)
       switch (DR)
       {
       case 0:
-        dphaseDRTable[DR][Rks] = 0;
+        rt->dphaseDRTable[DR][Rks] = 0;
         break;
       default:
-        dphaseDRTable[DR][Rks] = RATE_ADJUST ((RL + 4) << (RM - 1));
+        rt->dphaseDRTable[DR][Rks] = RATE_ADJUST (rt, (RL + 4) << (RM - 1));
         break;
       }
     }
@@ -538,27 +524,27 @@ calc_eg_dphase (OPLL_SLOT * slot)
   switch (slot->eg_mode)
   {
   case ATTACK:
-    return dphaseARTable[slot->patch->AR][slot->rks];
+    return slot->rt->dphaseARTable[slot->patch->AR][slot->rks];
 
   case DECAY:
-    return dphaseDRTable[slot->patch->DR][slot->rks];
+    return slot->rt->dphaseDRTable[slot->patch->DR][slot->rks];
 
   case SUSHOLD:
     return 0;
 
   case SUSTINE:
-    return dphaseDRTable[slot->patch->RR][slot->rks];
+    return slot->rt->dphaseDRTable[slot->patch->RR][slot->rks];
 
   case RELEASE:
     if (slot->sustine)
-      return dphaseDRTable[5][slot->rks];
+      return slot->rt->dphaseDRTable[5][slot->rks];
     else if (slot->patch->EG)
-      return dphaseDRTable[slot->patch->RR][slot->rks];
+      return slot->rt->dphaseDRTable[slot->patch->RR][slot->rks];
     else
-      return dphaseDRTable[7][slot->rks];
+      return slot->rt->dphaseDRTable[7][slot->rks];
 
   case SETTLE:
-    return dphaseDRTable[15][0];
+    return slot->rt->dphaseDRTable[15][0];
 
   case FINISH:
     return 0;
@@ -580,7 +566,7 @@ calc_eg_dphase (OPLL_SLOT * slot)
 #define SLOT_TOM 16
 #define SLOT_CYM 17
 
-#define UPDATE_PG(S)  (S)->dphase = dphaseTable[(S)->fnum][(S)->block][(S)->patch->ML]
+#define UPDATE_PG(S)  (S)->dphase = (S)->rt->dphaseTable[(S)->fnum][(S)->block][(S)->patch->ML]
 #define UPDATE_TLL(S)\
 (((S)->type==0)?\
 ((S)->tll = tllTable[((S)->fnum)>>5][(S)->block][(S)->patch->TL][(S)->patch->KL]):\
@@ -863,9 +849,10 @@ OPLL_copyPatch (OPLL * opll, int32_t num, OPLL_PATCH * patch)
 ***********************************************************/
 
 static void
-OPLL_SLOT_reset (OPLL_SLOT * slot, int type)
+OPLL_SLOT_reset (OPLL_SLOT * slot, const OPLL_RATE * rt, int type)
 {
   slot->type = type;
+  slot->rt = rt;
   slot->sintbl = waveform[0];
   slot->phase = 0;
   slot->dphase = 0;
@@ -887,36 +874,27 @@ OPLL_SLOT_reset (OPLL_SLOT * slot, int type)
 }
 
 static void
-internal_refresh (void)
+internal_refresh (OPLL_RATE *rt)
 {
-  makeDphaseTable ();
-  makeDphaseARTable ();
-  makeDphaseDRTable ();
-  pm_dphase = (uint32_t) RATE_ADJUST (PM_SPEED * PM_DP_WIDTH / (clk / 72));
-  am_dphase = (uint32_t) RATE_ADJUST (AM_SPEED * AM_DP_WIDTH / (clk / 72));
+  makeDphaseTable (rt);
+  makeDphaseARTable (rt);
+  makeDphaseDRTable (rt);
+  rt->pm_dphase = (uint32_t) RATE_ADJUST (rt, PM_SPEED * PM_DP_WIDTH / (rt->clk / 72));
+  rt->am_dphase = (uint32_t) RATE_ADJUST (rt, AM_SPEED * AM_DP_WIDTH / (rt->clk / 72));
 }
 
-static void
-maketables (uint32_t c, uint32_t r)
+/* Tables which depend on neither the clock nor the sampling rate */
+void
+OPLL_init_tables (void)
 {
-  if (c != clk)
-  {
-    clk = c;
-    makePmTable ();
-    makeAmTable ();
-    makeDB2LinTable ();
-    makeAdjustTable ();
-    makeTllTable ();
-    makeRksTable ();
-    makeSinTable ();
-    makeDefaultPatch ();
-  }
-
-  if (r != rate)
-  {
-    rate = r;
-    internal_refresh ();
-  }
+  makePmTable ();
+  makeAmTable ();
+  makeDB2LinTable ();
+  makeAdjustTable ();
+  makeTllTable ();
+  makeRksTable ();
+  makeSinTable ();
+  makeDefaultPatch ();
 }
 
 OPLL *
@@ -925,12 +903,14 @@ OPLL_new (uint32_t c, uint32_t r)		// // //
   OPLL *opll;
   int32_t i;
 
-  maketables (c, r);
-
   opll = (OPLL *) calloc (sizeof (OPLL), 1);
   if (opll == NULL)
     return NULL;
 
+  opll->rt.clk = c;
+  opll->rt.rate = r;
+  internal_refresh (&opll->rt);
+
   for (i = 0; i < 19 * 2; i++)
     memcpy(&opll->patch[i],&null_patch,sizeof(OPLL_PATCH));
 
@@ -979,7 +959,7 @@ OPLL_reset (OPLL * opll)
   opll->mask = 0;
 
   for (i = 0; i <18; i++)
-    OPLL_SLOT_reset(&opll->slot[i], i%2);
+    OPLL_SLOT_reset(&opll->slot[i], &opll->rt, i%2);
 
   for (i = 0; i < 9; i++)
   {
@@ -990,8 +970,11 @@ OPLL_reset (OPLL * opll)
   for (i = 0; i < 0x40; i++)
     OPLL_writeReg (opll, i, 0);
 
-  opll->realstep = (uint32_t) ((1 << 31) / rate);
-  opll->opllstep = (uint32_t) ((1 << 31) / (clk / 72));
+  opll->realstep = (uint32_t) ((1 << 31) / opll->rt.rate);
+  opll->opllstep = (uint32_t) ((1 << 31) / (opll->rt.clk / 72));
+
+  for (i = 0; i < 10; i++)
+    opll->volumes[i] = 0;
   opll->oplltime = 0;
   for (i = 0; i < 14; i++)
     opll->pan[i] = 2;
@@ -1024,18 +1007,61 @@ void
 OPLL_set_rate (OPLL * opll, uint32_t r)
 {
   if (opll->quality)
-    rate = 49716;
+    opll->rt.rate = 49716;
   else
-    rate = r;
-  internal_refresh ();
-  rate = r;
+    opll->rt.rate = r;
+  internal_refresh (&opll->rt);
+  opll->rt.rate = r;
 }
 
 void
 OPLL_set_quality (OPLL * opll, uint32_t q)
 {
   opll->quality = q;
-  OPLL_set_rate (opll, rate);
+  OPLL_set_rate (opll, opll->rt.rate);
+}
+
+/* // // // State snapshots. Everything before the rate tables is copied, the
+   slots' pointers are stored as indices and re-pointed into the target OPLL. */
+#define STATE_COPY_SIZE offsetof (OPLL, rt)
+
+uint32_t
+OPLL_state_size (void)
+{
+  return (uint32_t) (STATE_COPY_SIZE + sizeof (int32_t) * 18 * 2);
+}
+
+void
+OPLL_save_state (const OPLL * opll, void *buf)
+{
+  int32_t idx[18 * 2];
+  int32_t i;
+
+  memcpy (buf, opll, STATE_COPY_SIZE);
+  for (i = 0; i < 18; i++)
+  {
+    const OPLL_SLOT *slot = &opll->slot[i];
+    idx[i * 2 + 0] = slot->patch == &null_patch ? -1 : (int32_t) (slot->patch - opll->patch);
+    idx[i * 2 + 1] = slot->sintbl == waveform[1] ? 1 : 0;
+  }
+  memcpy ((uint8_t *) buf + STATE_COPY_SIZE, idx, sizeof idx);
+}
+
+void
+OPLL_load_state (OPLL * opll, const void *buf)
+{
+  int32_t idx[18 * 2];
+  int32_t i;
+
+  memcpy (opll, buf, STATE_COPY_SIZE);
+  memcpy (idx, (const uint8_t *) buf + STATE_COPY_SIZE, sizeof idx);
+  for (i = 0; i < 18; i++)
+  {
+    OPLL_SLOT *slot = &opll->slot[i];
+    slot->patch = idx[i * 2 + 0] < 0 ? &null_patch : &opll->patch[idx[i * 2 + 0]];
+    slot->sintbl = waveform[idx[i * 2 + 1]];
+    slot->rt = &opll->rt;
+  }
 }
 
 /*********************************************************
@@ -1072,8 +1098,8 @@ OPLL_set_quality (OPLL * opll, uint32_t q)
 static void
 update_ampm (OPLL * opll)
 {
-  opll->pm_phase = (opll->pm_phase + pm_dphase) & (PM_DP_WIDTH - 1);
-  opll->am_phase = (opll->am_phase + am_dphase) & (AM_DP_WIDTH - 1);
+  opll->pm_phase = (opll->pm_phase + opll->rt.pm_dphase) & (PM_DP_WIDTH - 1);
+  opll->am_phase = (opll->am_phase + opll->rt.am_dphase) & (AM_DP_WIDTH - 1);
   opll->lfo_am = amtable[HIGHBITS (opll->am_phase, AM_DP_BITS - AM_PG_BITS)];
   opll->lfo_pm = pmtable[HIGHBITS (opll->pm_phase, PM_DP_BITS - PM_PG_BITS)];
 }
@@ -1113,6 +1139,13 @@ calc_envelope (OPLL_SLOT * slot, int32_t lfo)
 
   uint32_t egout;
 
+  /* a finished slot is always muted, AM cannot bring it back */
+  if (slot->eg_mode == FINISH)		// // //
+  {
+    slot->egout = (DB_MUTE - 1) | 3;
+    return;
+  }
+
   switch (slot->eg_mode)
   {
   case ATTACK:
@@ -1346,8 +1379,8 @@ update_output (OPLL * opll)
     {
       opll->ch_out[i] += calc_slot_car (CAR(opll,i), calc_slot_mod(MOD(opll,i))) * INST_VOL_MULT;
 	  int16_t absvol = abs(opll->ch_out[i]);
-      if (absvol > opll_volumes[i])
-        opll_volumes[i] = absvol;
+      if (absvol > opll->volumes[i])
+        opll->volumes[i] = absvol;
     }
 
   /* CH7 */
@@ -1391,19 +1424,38 @@ update_output (OPLL * opll)
   }
 
   /* Always calc average of two samples */
+#ifdef EMU2413_SSE2		// // // halve and mix all channels at once
+  {
+    /* both halves are loaded before either is stored, ch_out[7] is in both */
+    const __m128i ones = _mm_set1_epi16 (1);
+    const __m128i skip7 = _mm_set_epi16 (-1, -1, -1, -1, -1, -1, -1, 0);
+    __m128i lo = _mm_srai_epi16 (_mm_loadu_si128 ((const __m128i *) &opll->ch_out[0]), 1);
+    __m128i hi = _mm_srai_epi16 (_mm_loadu_si128 ((const __m128i *) &opll->ch_out[7]), 1);
+    __m128i sum;
+    _mm_storeu_si128 ((__m128i *) &opll->ch_out[7], hi);
+    _mm_storeu_si128 ((__m128i *) &opll->ch_out[0], lo);
+    sum = _mm_add_epi32 (_mm_madd_epi16 (lo, ones), _mm_madd_epi16 (_mm_and_si128 (hi, skip7), ones));
+    sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (1, 0, 3, 2)));
+    sum = _mm_add_epi32 (sum, _mm_shuffle_epi32 (sum, _MM_SHUFFLE (2, 3, 0, 1)));
+    opll->out = _mm_cvtsi128_si32 (sum);
+  }
+#else
   for (i=0;i<15;i++) {
     opll->ch_out[i] >>= 1;
   }
+#endif
 
 }
 
 static inline int16_t
 mix_output(OPLL *opll) {
+#ifndef EMU2413_SSE2		// // // already summed by update_output
   int i;
   opll->out = opll->ch_out[0];
   for (i=1;i<15;i++) {
     opll->out += opll->ch_out[i];
   }
+#endif
   return (int16_t)opll->out;
 }
 
@@ -1749,9 +1801,9 @@ OPLL_set_pan (OPLL * opll, uint32_t ch, uint32_t pan)
 }
 
 
-int16_t OPLL_getchanvol(int i)
+int16_t OPLL_getchanvol(OPLL *opll, int i)
 {
-	int16_t retval = opll_volumes[i];
-	opll_volumes[i] = 0;
+	int16_t retval = opll->volumes[i];
+	opll->volumes[i] = 0;
 	return retval;
 }
@@ -41,10 +41,28 @@ typedef struct __OPLL_PATCH {
   uint32_t TL,FB,EG,ML,AR,DR,SL,RR,KR,KL,AM,PM,WF ;
 } OPLL_PATCH ;
 
+/* sampling rate dependent tables, owned by each OPLL */
+typedef struct __OPLL_RATE {
+  uint32_t clk ;
+  uint32_t rate ;
+
+  /* Phase delta for LFO */
+  uint32_t pm_dphase ;
+  uint32_t am_dphase ;
+
+  /* Phase incr table for Attack */
+  uint32_t dphaseARTable[16][16] ;
+  /* Phase incr table for Decay and Release */
+  uint32_t dphaseDRTable[16][16] ;
+  /* Phase incr table for PG */
+  uint32_t dphaseTable[512][8][16] ;
+} OPLL_RATE ;
+
 /* slot */
 typedef struct __OPLL_SLOT {
 
   OPLL_PATCH *patch;
+  const OPLL_RATE *rt ;
 
   int32_t type ;          /* 0 : modulator 1 : carrier */
 
@@ -125,8 +143,16 @@ typedef struct __OPLL {
   /* Output of each channels / 0-8:TONE, 9:BD 10:HH 11:SD, 12:TOM, 13:CYM, 14:Reserved for DAC */
   int16_t ch_out[15];
 
+  /* Peak channel levels since the last OPLL_getchanvol call */
+  int16_t volumes[10] ;
+
+  OPLL_RATE rt ;
+
 } OPLL ;
 
+/* Build the shared constant tables, must be called once before OPLL_new */
+void OPLL_init_tables(void) ;
+
 /* Create Object */
 OPLL *OPLL_new(uint32_t clk, uint32_t rate) ;
 void OPLL_delete(OPLL *) ;
@@ -138,6 +164,11 @@ void OPLL_set_rate(OPLL *opll, uint32_t r) ;
 void OPLL_set_quality(OPLL *opll, uint32_t q) ;
 void OPLL_set_pan(OPLL *, uint32_t ch, uint32_t pan);
 
+/* // // // State snapshots, only valid for an OPLL with the same clock, rate and quality */
+uint32_t OPLL_state_size(void) ;
+void OPLL_save_state(const OPLL *, void *buf) ;
+void OPLL_load_state(OPLL *, const void *buf) ;
+
 /* Port/Register access */
 void OPLL_writeIO(OPLL *, uint32_t reg, uint32_t val) ;
 void OPLL_writeReg(OPLL *, uint32_t reg, uint32_t val) ;
@@ -159,7 +190,7 @@ void OPLL_getDefaultPatch(int32_t type, int32_t num, OPLL_PATCH *) ;
 uint32_t OPLL_setMask(OPLL *, uint32_t mask) ;
 uint32_t OPLL_toggleMask(OPLL *, uint32_t mask) ;
 
-int16_t OPLL_getchanvol(int i);
+int16_t OPLL_getchanvol(OPLL *, int i);
 
 #ifdef __cplusplus
 }
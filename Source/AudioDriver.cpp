@@ -21,7 +21,11 @@
 */
 
 #include "AudioDriver.h"
-#include "DirectSound.h"
+#include "AudioSink.h"		// // //
+#include "WaveStream.h"		// // //
+#include "Assertion.h"		// // //
+#include <cmath>		// // //
+#include <limits>		// // //
 
 // 1kHz test tone
 //#define AUDIO_TEST
@@ -33,14 +37,20 @@
 int dither(long size);
 #endif
 
-CAudioDriver::CAudioDriver(IAudioCallback &Parent, std::unique_ptr<CDSoundChannel> pDevice, unsigned SampleSize) :
+namespace {
+
+// // // blocks that one frame of emulation can finish before they are played
+constexpr std::size_t QUEUED_BLOCKS = 8u;
+
+} // namespace
+
+CAudioDriver::CAudioDriver(IAudioCallback &Parent, std::unique_ptr<CAudioSink> pDevice, unsigned SampleSize) :
+	m_pAudioSink(std::move(pDevice)),		// // //
 	m_Parent(Parent),
-	m_pDSoundChannel(std::move(pDevice)),
 	m_iSampleSize(SampleSize),
-	m_iBufSizeBytes(m_pDSoundChannel ? m_pDSoundChannel->GetBlockSize() : 0),
+	m_iBufSizeBytes(m_pAudioSink ? m_pAudioSink->GetBlockSize() : 0),
 	m_iBufSizeSamples(m_iBufSizeBytes / (SampleSize / 8)),
-	m_pAccumBuffer(std::make_unique<char[]>(m_iBufSizeBytes)),		// // //
-	m_iGraphBuffer(std::make_unique<int16_t[]>(m_iBufSizeSamples))
+	m_Blocks(QUEUED_BLOCKS, stAudioBlock {std::vector<char>(m_iBufSizeBytes), std::vector<int16_t>(m_iBufSizeSamples)})		// // //
 {
 }
 
@@ -50,12 +60,24 @@ CAudioDriver::~CAudioDriver() {
 
 void CAudioDriver::Reset() {
 	m_iBufferPtr = 0;
-	if (m_pDSoundChannel)
-		m_pDSoundChannel->ClearBuffer();
+	m_iFirstBlock = 0;		// // //
+	m_iFinishedBlocks = 0;
+	m_pFillBlock = nullptr;
+	if (m_pAudioSink)
+		m_pAudioSink->ClearBuffer();
 }
 
 void CAudioDriver::FlushBuffer(array_view<int16_t> Buffer) {
-	if (!m_pDSoundChannel)
+	FlushBufferImpl(Buffer);		// // //
+}
+
+void CAudioDriver::FlushBuffer(array_view<float> Buffer) {		// // //
+	FlushBufferImpl(Buffer);
+}
+
+template <class U>
+void CAudioDriver::FlushBufferImpl(array_view<U> Buffer) {		// // //
+	if (!m_pAudioSink)
 		return;
 
 	if (m_iSampleSize == 8)
@@ -76,22 +98,55 @@ bool CAudioDriver::PlayBuffer() {
 	return m_Parent.PlayBuffer();
 }
 
+bool CAudioDriver::PlayBlocks() {		// // //
+	// Flushes the finished blocks to the device, called on the player thread
+	// after the APU lock is released, so that waiting for the device never
+	// blocks other users of the APU
+	while (m_iFinishedBlocks) {
+		bool Played = PlayBuffer();
+		PopBlock();
+		if (!Played) {
+			while (m_iFinishedBlocks)
+				PopBlock();
+			return false;
+		}
+	}
+	return true;
+}
+
+void CAudioDriver::PopBlock() {		// // //
+	m_iFirstBlock = (m_iFirstBlock + 1) % m_Blocks.size();
+	--m_iFinishedBlocks;
+}
+
+bool CAudioDriver::DrainBlocks() {		// // //
+	// Finishes the partly filled block as a short one and plays everything, called
+	// once no more samples will follow; the sound device pads it with silence
+	if (m_pFillBlock && m_iBufferPtr > 0) {
+		m_pFillBlock->Length = m_iBufferPtr;
+		++m_iFinishedBlocks;
+		m_pFillBlock = nullptr;
+		m_iBufferPtr = 0;
+	}
+	return PlayBlocks();
+}
+
 bool CAudioDriver::DoPlayBuffer() {
 	const int AUDIO_TIMEOUT = 2000;		// // // 2s buffer timeout
 
-	// Output to direct sound
-	DWORD dwEvent;
+	// Output to the sink
+	buffer_event_t dwEvent;		// // //
 
 	// Wait for a buffer event
-	while ((dwEvent = m_pDSoundChannel->WaitForSyncEvent(AUDIO_TIMEOUT)) != BUFFER_IN_SYNC) {
+	while ((dwEvent = m_pAudioSink->WaitForSyncEvent(AUDIO_TIMEOUT)) != BUFFER_IN_SYNC) {
 		switch (dwEvent) {
 			case BUFFER_TIMEOUT:
 				// Buffer timeout
 				m_bBufferTimeout = true;
+				[[fallthrough]];		// // //
 			case BUFFER_CUSTOM_EVENT:
 				// Custom event, quit
-				m_iBufferPtr = 0;
-				return false;
+				return false;		// // // PlayBlocks drops the finished blocks
 			case BUFFER_OUT_OF_SYNC:
 				// Buffer underrun detected
 				++m_iAudioUnderruns;
@@ -101,7 +156,9 @@ bool CAudioDriver::DoPlayBuffer() {
 	}
 
 	// Write audio to buffer
-	m_pDSoundChannel->WriteBuffer(ReleaseSoundBuffer());		// // //
+	auto Buffer = ReleaseSoundBuffer();		// // //
+	if (m_pAudioSink->WriteBuffer(Buffer))
+		m_iWrittenBytes += Buffer.size();
 
 	// Reset buffer position
 	m_bBufferTimeout = false;
@@ -110,27 +167,37 @@ bool CAudioDriver::DoPlayBuffer() {
 }
 
 array_view<char> CAudioDriver::ReleaseSoundBuffer() {
-	m_iBufferPtr = 0;
-	return {m_pAccumBuffer.get(), m_iBufSizeBytes};
+	// // // the oldest finished block
+	if (!m_iFinishedBlocks)
+		return { };
+	const auto &Block = m_Blocks[m_iFirstBlock];
+	return {Block.Samples.data(), Block.Length * (m_iSampleSize / 8)};
 }
 
 array_view<std::int16_t> CAudioDriver::ReleaseGraphBuffer() {
-	return {m_iGraphBuffer.get(), m_iBufSizeSamples};
+	if (!m_iFinishedBlocks)		// // //
+		return { };
+	const auto &Block = m_Blocks[m_iFirstBlock];
+	return {Block.Graph.data(), Block.Length};
 }
 
 unsigned CAudioDriver::GetSampleSize() const noexcept {		// // //
 	return m_iSampleSize;
 }
 
+std::size_t CAudioDriver::GetWrittenBytes() const noexcept {		// // //
+	return m_iWrittenBytes;
+}
+
 void CAudioDriver::CloseAudioDevice() {
-	if (m_pDSoundChannel) {
-		m_pDSoundChannel->Stop();
-		m_pDSoundChannel.reset();		// // //
+	if (m_pAudioSink) {
+		m_pAudioSink->Stop();
+		m_pAudioSink.reset();		// // //
 	}
 }
 
 bool CAudioDriver::IsAudioDeviceOpen() const {
-	return static_cast<bool>(m_pDSoundChannel);
+	return static_cast<bool>(m_pAudioSink);
 }
 
 bool CAudioDriver::GetSoundTimeout() const {
@@ -149,15 +216,22 @@ unsigned CAudioDriver::GetUnderruns() const {
 	return m_iAudioUnderruns;
 }
 
-template <class T, int SHIFT>
-void CAudioDriver::FillBuffer(array_view<int16_t> Buffer)		// // //
+template <class T, int SHIFT, class U>
+void CAudioDriver::FillBuffer(array_view<U> Buffer)		// // //
 {
 	// Called when the APU audio buffer is full and
 	// ready for playing
 
-	auto pConversionBuffer = reinterpret_cast<T *>(m_pAccumBuffer.get());		// // //
+	for (U Input : Buffer) {		// // //
+		if (!m_pFillBlock) {
+			// the device is a whole ring behind, play the finished blocks now
+			if (m_iFinishedBlocks == m_Blocks.size() && !PlayBlocks())
+				return;
+			m_pFillBlock = &m_Blocks[(m_iFirstBlock + m_iFinishedBlocks) % m_Blocks.size()];
+		}
 
-	for (int16_t Sample : Buffer) {		// // //
+		// // // the device only takes 16-bit samples, float samples are clipped here
+		int16_t Sample = details::convert_sample<int16_t>(Input, 16);
 		// 1000 Hz test tone
 #ifdef AUDIO_TEST
 		static double sine_phase = 0;
@@ -169,7 +243,7 @@ void CAudioDriver::FillBuffer(array_view<int16_t> Buffer)		// // //
 		if (freq > 20000)
 			freq = 20;
 
-		sine_phase += freq / (double(m_pDSoundChannel->GetSampleRate()) / 6.283184);
+		sine_phase += freq / (double(m_pAudioSink->GetSampleRate()) / 6.283184);
 		if (sine_phase > 6.283184)
 			sine_phase -= 6.283184;
 #endif /* AUDIO_TEST */
@@ -178,10 +252,10 @@ void CAudioDriver::FillBuffer(array_view<int16_t> Buffer)		// // //
 		if (Sample == std::numeric_limits<int16_t>::max() || Sample == std::numeric_limits<int16_t>::min())
 			++m_iClipCounter;
 
-		ASSERT(m_iBufferPtr < m_iBufSizeSamples);
+		Assert(m_iBufferPtr < m_iBufSizeSamples);		// // //
 
 		// Visualizer
-		m_iGraphBuffer[m_iBufferPtr] = (short)Sample;
+		m_pFillBlock->Graph[m_iBufferPtr] = (short)Sample;		// // //
 
 		// Convert sample and store in temp buffer
 #ifdef DITHERING
@@ -194,12 +268,14 @@ void CAudioDriver::FillBuffer(array_view<int16_t> Buffer)		// // //
 		if (SHIFT == 8)
 			Sample ^= 0x80;
 
-		pConversionBuffer[m_iBufferPtr++] = (T)Sample;
+		reinterpret_cast<T *>(m_pFillBlock->Samples.data())[m_iBufferPtr++] = (T)Sample;		// // //
 
-		// If buffer is filled, throw it to direct sound
+		// // // If buffer is filled, keep it for the next flush to direct sound
 		if (m_iBufferPtr >= m_iBufSizeSamples) {
-			if (!PlayBuffer())
-				return;
+			m_pFillBlock->Length = m_iBufSizeSamples;
+			++m_iFinishedBlocks;
+			m_pFillBlock = nullptr;
+			m_iBufferPtr = 0;
 		}
 	}
 }
@@ -26,26 +26,31 @@
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>		// // //
 #include "Common.h"
 #include "array_view.h"
 
-class CDSoundChannel;
+class CAudioSink;
 
 class CAudioDriver : public IAudioCallback {
 public:
 	CAudioDriver(const CAudioDriver &) = delete;
 	virtual ~CAudioDriver();
 
-	CAudioDriver(IAudioCallback &Parent, std::unique_ptr<CDSoundChannel> pDevice, unsigned SampleSize);
+	CAudioDriver(IAudioCallback &Parent, std::unique_ptr<CAudioSink> pDevice, unsigned SampleSize);
 
 	void Reset();
 	void FlushBuffer(array_view<int16_t> Buffer) override;
+	void FlushBuffer(array_view<float> Buffer) override;		// // //
 	bool PlayBuffer() override;
+	bool PlayBlocks();		// // //
+	bool DrainBlocks();		// // //
 	bool DoPlayBuffer();
 	array_view<char> ReleaseSoundBuffer();
 	array_view<std::int16_t> ReleaseGraphBuffer();
 
 	unsigned GetSampleSize() const noexcept;		// // //
+	std::size_t GetWrittenBytes() const noexcept;		// // //
 
 	void CloseAudioDevice();
 	bool IsAudioDeviceOpen() const;
@@ -56,19 +61,33 @@ public:
 	unsigned GetUnderruns() const;
 
 private:
-	template <class T, int SHIFT>
-	void FillBuffer(array_view<int16_t> Buffer);		// // //
+	template <class T, int SHIFT, class U>
+	void FillBuffer(array_view<U> Buffer);		// // //
+	template <class U>
+	void FlushBufferImpl(array_view<U> Buffer);		// // //
+	void PopBlock();		// // //
 
 private:
-	std::unique_ptr<CDSoundChannel> m_pDSoundChannel;		// // // directsound channel
+	// // // one device block of converted samples, with 16-bit copies for the visualizer
+	struct stAudioBlock {
+		std::vector<char> Samples;
+		std::vector<int16_t> Graph;
+		unsigned int Length = 0;		// in samples, only the last block is short
+	};
+
+private:
+	std::unique_ptr<CAudioSink> m_pAudioSink;				// // // directsound channel or another sink
 	IAudioCallback		&m_Parent;							// // //
 
 	unsigned int		m_iSampleSize;						// Size of samples, in bits
 	unsigned int		m_iBufSizeBytes = 0;				// Buffer size in bytes
 	unsigned int		m_iBufSizeSamples = 0;				// Buffer size in samples
 	unsigned int		m_iBufferPtr = 0;					// This will point in samples
-	std::unique_ptr<char[]> m_pAccumBuffer;					// // //
-	std::unique_ptr<int16_t[]> m_iGraphBuffer;
+	std::vector<stAudioBlock> m_Blocks;						// // // ring of blocks, reused for every frame
+	std::size_t			m_iFirstBlock = 0;					// // // oldest block waiting for the device
+	std::size_t			m_iFinishedBlocks = 0;				// // // blocks waiting for the device
+	stAudioBlock		*m_pFillBlock = nullptr;			// // // block being filled, the one after the finished blocks
+	std::size_t			m_iWrittenBytes = 0;				// // // bytes the sink has accepted
 	unsigned int		m_iAudioUnderruns = 0;				// Keep track of underruns to inform user
 	bool				m_bBufferTimeout = false;
 	bool				m_bBufferUnderrun = false;
@@ -0,0 +1,134 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "AudioSink.h"
+#include "WaveStream.h"
+
+CNullAudioSink::CNullAudioSink(int SampleRate, int BlockSize) :
+	m_iSampleRate(SampleRate), m_iBlockSize(BlockSize)
+{
+}
+
+bool CNullAudioSink::Stop() const {
+	return true;
+}
+
+bool CNullAudioSink::ClearBuffer() {
+	return true;
+}
+
+bool CNullAudioSink::WriteBuffer(array_view<char> Buffer) {
+	m_iWrittenBytes += Buffer.size();
+	return true;
+}
+
+buffer_event_t CNullAudioSink::WaitForSyncEvent(std::uint32_t dwTimeout) const {
+	return BUFFER_IN_SYNC;
+}
+
+int CNullAudioSink::GetBlockSize() const {
+	return m_iBlockSize;
+}
+
+int CNullAudioSink::GetSampleRate() const {
+	return m_iSampleRate;
+}
+
+std::size_t CNullAudioSink::GetWrittenBytes() const {
+	return m_iWrittenBytes;
+}
+
+
+
+CPipeAudioSink::CPipeAudioSink(std::FILE *pFile, int SampleRate, int BlockSize) :
+	m_pFile(pFile), m_iSampleRate(SampleRate), m_iBlockSize(BlockSize)
+{
+}
+
+bool CPipeAudioSink::Stop() const {
+	return !std::fflush(m_pFile);
+}
+
+bool CPipeAudioSink::ClearBuffer() {
+	return true;
+}
+
+bool CPipeAudioSink::WriteBuffer(array_view<char> Buffer) {
+	if (!m_bFailed && std::fwrite(Buffer.data(), 1, Buffer.size(), m_pFile) != Buffer.size())
+		m_bFailed = true;
+	return !m_bFailed;
+}
+
+buffer_event_t CPipeAudioSink::WaitForSyncEvent(std::uint32_t dwTimeout) const {
+	// a closed pipe stops playback like an interrupt does
+	return m_bFailed ? BUFFER_CUSTOM_EVENT : BUFFER_IN_SYNC;
+}
+
+int CPipeAudioSink::GetBlockSize() const {
+	return m_iBlockSize;
+}
+
+int CPipeAudioSink::GetSampleRate() const {
+	return m_iSampleRate;
+}
+
+
+
+CWaveAudioSink::CWaveAudioSink(std::unique_ptr<COutputWaveStream> pStream, int SampleSize, int SampleRate, int BlockSize) :
+	m_pStream(std::move(pStream)), m_iSampleSize(SampleSize), m_iSampleRate(SampleRate), m_iBlockSize(BlockSize)
+{
+	m_pStream->WriteWAVHeader();
+}
+
+CWaveAudioSink::~CWaveAudioSink() noexcept {
+}
+
+bool CWaveAudioSink::Stop() const {
+	return true;
+}
+
+bool CWaveAudioSink::ClearBuffer() {
+	return true;
+}
+
+bool CWaveAudioSink::WriteBuffer(array_view<char> Buffer) {
+	// same sample formats as CAudioDriver::FillBuffer
+	if (m_iSampleSize == 8)
+		m_pStream->WriteSamples(array_view<std::uint8_t>(
+			reinterpret_cast<const std::uint8_t *>(Buffer.data()), Buffer.size() / sizeof(std::uint8_t)));
+	else
+		m_pStream->WriteSamples(array_view<std::int16_t>(
+			reinterpret_cast<const std::int16_t *>(Buffer.data()), Buffer.size() / sizeof(std::int16_t)));
+	return true;
+}
+
+buffer_event_t CWaveAudioSink::WaitForSyncEvent(std::uint32_t dwTimeout) const {
+	return BUFFER_IN_SYNC;
+}
+
+int CWaveAudioSink::GetBlockSize() const {
+	return m_iBlockSize;
+}
+
+int CWaveAudioSink::GetSampleRate() const {
+	return m_iSampleRate;
+}
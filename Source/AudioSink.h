@@ -0,0 +1,118 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include "array_view.h"
+
+class COutputWaveStream;
+
+// Return values from WaitForDirectSoundEvent()
+enum buffer_event_t {
+	BUFFER_NONE = 0,
+	BUFFER_CUSTOM_EVENT = 1,
+	BUFFER_TIMEOUT,
+	BUFFER_IN_SYNC,
+	BUFFER_OUT_OF_SYNC,
+};
+
+// // // Destination of the blocks written by CAudioDriver
+class CAudioSink {
+public:
+	virtual ~CAudioSink() noexcept = default;
+
+	virtual bool Stop() const = 0;
+	virtual bool ClearBuffer() = 0;
+	// one block, the last one before the driver is drained may be shorter
+	virtual bool WriteBuffer(array_view<char> Buffer) = 0;
+
+	// waits until the next block can be written
+	virtual buffer_event_t WaitForSyncEvent(std::uint32_t dwTimeout) const = 0;
+
+	virtual int GetBlockSize() const = 0;		// in bytes
+	virtual int GetSampleRate() const = 0;
+};
+
+// // // Discards every block as soon as it is written, for timing the emulation alone
+class CNullAudioSink : public CAudioSink {
+public:
+	CNullAudioSink(int SampleRate, int BlockSize);
+
+	bool Stop() const override;
+	bool ClearBuffer() override;
+	bool WriteBuffer(array_view<char> Buffer) override;
+	buffer_event_t WaitForSyncEvent(std::uint32_t dwTimeout) const override;
+	int GetBlockSize() const override;
+	int GetSampleRate() const override;
+
+	std::size_t GetWrittenBytes() const;
+
+private:
+	int m_iSampleRate;
+	int m_iBlockSize;
+	std::size_t m_iWrittenBytes = 0u;
+};
+
+// // // Writes the blocks as raw PCM to a stream that it does not own, such as
+// stdout or a pipe into an encoder; a failed write ends playback
+class CPipeAudioSink : public CAudioSink {
+public:
+	CPipeAudioSink(std::FILE *pFile, int SampleRate, int BlockSize);
+
+	bool Stop() const override;
+	bool ClearBuffer() override;
+	bool WriteBuffer(array_view<char> Buffer) override;
+	buffer_event_t WaitForSyncEvent(std::uint32_t dwTimeout) const override;
+	int GetBlockSize() const override;
+	int GetSampleRate() const override;
+
+private:
+	std::FILE *m_pFile;
+	int m_iSampleRate;
+	int m_iBlockSize;
+	bool m_bFailed = false;
+};
+
+// // // Writes the blocks to a WAV file, the format must match CAudioDriver's output
+class CWaveAudioSink : public CAudioSink {
+public:
+	CWaveAudioSink(std::unique_ptr<COutputWaveStream> pStream, int SampleSize, int SampleRate, int BlockSize);
+	~CWaveAudioSink() noexcept;
+
+	bool Stop() const override;
+	bool ClearBuffer() override;
+	bool WriteBuffer(array_view<char> Buffer) override;
+	buffer_event_t WaitForSyncEvent(std::uint32_t dwTimeout) const override;
+	int GetBlockSize() const override;
+	int GetSampleRate() const override;
+
+private:
+	std::unique_ptr<COutputWaveStream> m_pStream;
+	int m_iSampleSize;
+	int m_iSampleRate;
+	int m_iBlockSize;
+};
@@ -22,7 +22,7 @@ more details. You should have received a copy of the GNU Lesser General
 Public License along with this module; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
-int const buffer_extra = blip_widest_impulse_ + 2;
+int const buffer_extra = blip_buffer_extra_;		// // //
 
 Blip_Buffer::Blip_Buffer()
 {
@@ -43,7 +43,7 @@ Blip_Buffer::Blip_Buffer()
 		long i = LONG_MIN;
 		assert( (i >> 1) == LONG_MIN / 2 );
 		i = LONG_MIN;
-		assert( (i >> 31) == -1 );
+		assert( (i >> (sizeof i * CHAR_BIT - 1)) == -1 );		// // // LP64
 
 		// casting to smaller signed type truncates bits and extends sign
 		i = (SHRT_MAX + 1) * 5;
@@ -165,11 +165,36 @@ void Blip_Buffer::remove_samples( long count )
 	}
 }
 
+// // // state snapshots
+
+void Blip_Buffer::save_state( blip_buffer_state_t* out ) const
+{
+	assert( samples_avail() == 0 ); // unread samples would be lost
+	out->offset_       = offset_;
+	out->reader_accum_ = reader_accum;
+	memcpy( out->buf, buffer_, sizeof out->buf );
+}
+
+void Blip_Buffer::load_state( blip_buffer_state_t const& in )
+{
+	clear();
+	offset_      = in.offset_;
+	reader_accum = in.reader_accum_;
+	memcpy( buffer_, in.buf, sizeof in.buf );
+}
+
 // Blip_Synth_
 
+#ifdef BLIP_BUFFER_SSE2
+Blip_Synth_::Blip_Synth_( short* p, short* k, int w ) :		// // //
+	impulses( p ),
+	kernels( k ),
+	width( w )
+#else
 Blip_Synth_::Blip_Synth_( short* p, int w ) :
 	impulses( p ),
 	width( w )
+#endif
 {
 	volume_unit_ = 0.0;
 	kernel_unit = 0;
@@ -219,6 +244,8 @@ void blip_eq_t::generate( float* out, int count ) const
 	double half_rate = sample_rate * 0.5;
 	if ( cutoff_freq )
 		oversample = half_rate / cutoff_freq;
+	else if ( reference_rate && sample_rate > reference_rate )		// // //
+		oversample *= (double) sample_rate / reference_rate; // treble is reached at the same frequency
 	double cutoff = rolloff_freq * oversample / half_rate;
 
 	gen_sinc( out, count, blip_res * oversample, treble, cutoff );
@@ -253,8 +280,29 @@ void Blip_Synth_::adjust_impulse()
 	//for ( int i = blip_res; i--; printf( "\n" ) )
 	//  for ( int j = 0; j < width / 2; j++ )
 	//      printf( "%5ld,", impulses [j * blip_res + i + 1] );
+
+#ifdef BLIP_BUFFER_SSE2
+	build_kernels();		// // //
+#endif
 }
 
+#ifdef BLIP_BUFFER_SSE2
+void Blip_Synth_::build_kernels()		// // //
+{
+	// same order in which Blip_Synth::offset_resampled() walks the impulses
+	int const half = width / 2;
+	for ( int phase = 0; phase < blip_res; phase++ )
+	{
+		short* k = kernels + phase * width;
+		for ( int i = 0; i < half; i++ )
+		{
+			k [i] = impulses [blip_res - phase + blip_res * i];
+			k [half + i] = impulses [phase + blip_res * (half - 1 - i)];
+		}
+	}
+}
+#endif
+
 void Blip_Synth_::treble_eq( blip_eq_t const& eq )
 {
 	float fimpulse [blip_res / 2 * (blip_widest_impulse_ - 1) + blip_res * 2];
@@ -363,6 +411,49 @@ int dither(long size)
 }
 #endif
 
+#ifdef BLIP_BUFFER_SSE2		// // //
+// Runs the bass filter over the buffer, replacing each input sample with the
+// accumulator value read out at that position. Returns the final accumulator.
+static long integrate_samples( Blip_Buffer::buf_t_* in, long count, long accum, int bass_shift )
+{
+	for ( long n = 0; n < count; n++ )
+	{
+		long s = accum;
+		accum -= accum >> bass_shift;
+		accum += in [n];
+		in [n] = s;
+	}
+	return accum;
+}
+
+// Narrows four accumulator values to 32 bits, returns false if any of them does
+// not fit
+static inline bool narrow_samples( Blip_Buffer::buf_t_ const* in, __m128i& out )
+{
+	if constexpr ( sizeof (Blip_Buffer::buf_t_) == 8 )
+	{
+		__m128i const a = _mm_shuffle_epi32( _mm_loadu_si128( (__m128i const*) in     ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		__m128i const b = _mm_shuffle_epi32( _mm_loadu_si128( (__m128i const*) in + 1 ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		out = _mm_unpacklo_epi64( a, b );
+		__m128i const high = _mm_unpackhi_epi64( a, b );
+		return _mm_movemask_epi8( _mm_cmpeq_epi32( high, _mm_srai_epi32( out, 31 ) ) ) == 0xFFFF;
+	}
+	else
+	{
+		out = _mm_loadu_si128( (__m128i const*) in );
+		return true;
+	}
+}
+
+static inline blip_sample_t clamp_sample( long accum )
+{
+	long s = accum >> (blip_sample_bits - 16);
+	if ( (blip_sample_t) s != s )
+		s = 0x7FFF - (s >> 24);
+	return (blip_sample_t) s;
+}
+#endif
+
 long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo )
 {
 	long count = samples_avail();
@@ -376,6 +467,37 @@ long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo
 		long accum = reader_accum;
 		buf_t_* in = buffer_;
 
+#if defined(BLIP_BUFFER_SSE2) && !defined(DITHERING)		// // //
+		// the input is discarded by remove_samples() below
+		accum = integrate_samples( in, count, accum, bass_shift_ );
+
+		int const step = stereo ? 2 : 1;
+		long n = 0;
+		for ( ; n + 4 <= count; n += 4 )
+		{
+			__m128i s;
+			if ( !narrow_samples( in + n, s ) )
+			{
+				for ( int i = 0; i < 4; i++ )
+					out [(n + i) * step] = clamp_sample( in [n + i] );
+				continue;
+			}
+			// saturation is the same as clamping for 32-bit accumulators
+			s = _mm_srai_epi32( s, sample_shift );
+			s = _mm_packs_epi32( s, s );
+			if ( !stereo )
+				_mm_storel_epi64( (__m128i*) (out + n), s );
+			else
+			{
+				out [n * 2    ] = (blip_sample_t) _mm_extract_epi16( s, 0 );
+				out [n * 2 + 2] = (blip_sample_t) _mm_extract_epi16( s, 1 );
+				out [n * 2 + 4] = (blip_sample_t) _mm_extract_epi16( s, 2 );
+				out [n * 2 + 6] = (blip_sample_t) _mm_extract_epi16( s, 3 );
+			}
+		}
+		for ( ; n < count; n++ )
+			out [n * step] = clamp_sample( in [n] );
+#else
 		if ( !stereo )
 		{
 			for ( long n = count; n--; )
@@ -409,6 +531,65 @@ long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo
 					out [-2] = (blip_sample_t) (0x7FFF - (s >> 24));
 			}
 		}
+#endif
+
+		reader_accum = accum;
+		remove_samples( count );
+	}
+	return count;
+}
+
+long Blip_Buffer::read_samples( float* out, long max_samples, int stereo )		// // //
+{
+	long count = samples_avail();
+	if ( count > max_samples )
+		count = max_samples;
+
+	if ( count )
+	{
+		// same scale as the 16-bit samples, keeping the bits below them
+		float const scale = 1.0f / (1L << (blip_sample_bits - 1));
+		int const bass_shift_ = this->bass_shift;
+		int const step = stereo ? 2 : 1;
+		long accum = reader_accum;
+		buf_t_* in = buffer_;
+
+#ifdef BLIP_BUFFER_SSE2
+		accum = integrate_samples( in, count, accum, bass_shift_ );
+
+		__m128 const vscale = _mm_set1_ps( scale );
+		long n = 0;
+		for ( ; n + 4 <= count; n += 4 )
+		{
+			__m128i s;
+			if ( !narrow_samples( in + n, s ) )
+			{
+				for ( int i = 0; i < 4; i++ )
+					out [(n + i) * step] = in [n + i] * scale;
+				continue;
+			}
+			__m128 const f = _mm_mul_ps( _mm_cvtepi32_ps( s ), vscale );
+			if ( !stereo )
+				_mm_storeu_ps( out + n, f );
+			else
+			{
+				float f4 [4];
+				_mm_storeu_ps( f4, f );
+				for ( int i = 0; i < 4; i++ )
+					out [(n + i) * 2] = f4 [i];
+			}
+		}
+		for ( ; n < count; n++ )
+			out [n * step] = in [n] * scale;
+#else
+		for ( long n = count; n--; )
+		{
+			*out = accum * scale;
+			out += step;
+			accum -= accum >> bass_shift_;
+			accum += *in++;
+		}
+#endif
 
 		reader_accum = accum;
 		remove_samples( count );
@@ -422,6 +603,19 @@ void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 
 	int const sample_shift = blip_sample_bits - 16;
 	int prev = 0;
+#ifdef BLIP_BUFFER_SSE2		// // // first differences of four samples at a time
+	for ( ; count >= 4; count -= 4 )
+	{
+		__m128i s = _mm_loadl_epi64( (__m128i const*) in );
+		s = _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 );
+		s = _mm_slli_epi32( s, sample_shift );
+		__m128i const last = _mm_or_si128( _mm_slli_si128( s, 4 ), _mm_cvtsi32_si128( prev ) );
+		blip_accumulate_( out, _mm_sub_epi32( s, last ) );
+		prev = _mm_cvtsi128_si32( _mm_srli_si128( s, 12 ) );
+		in += 4;
+		out += 4;
+	}
+#endif
 	while ( count-- )
 	{
 		long s = (long) *in++ << sample_shift;
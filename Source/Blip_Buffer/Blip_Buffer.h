@@ -13,6 +13,8 @@ typedef long blip_time_t;
 typedef short blip_sample_t;
 enum { blip_sample_max = 32767 };
 
+struct blip_buffer_state_t;		// // //
+
 class Blip_Buffer {
 public:
 	typedef const char* blargg_err_t;
@@ -36,6 +38,10 @@ public:
 	// easy interleving of two channels into a stereo output buffer.
 	long read_samples( blip_sample_t* dest, long max_samples, int stereo = 0 );
 
+	// // // Same as above, but with float samples where 1.0 is full scale. Samples
+	// are neither clamped nor truncated to 16 bits.
+	long read_samples( float* dest, long max_samples, int stereo = 0 );
+
 // Additional optional features
 
 	// Current output sample rate
@@ -63,6 +69,12 @@ public:
 	// Remove 'count' samples from those waiting to be read
 	void remove_samples( long count );
 
+	// // // Save the synthesis state of a buffer with no samples waiting to be read,
+	// to be loaded later into a buffer with the same sample and clock rates. Loading
+	// discards everything in the buffer.
+	void save_state( blip_buffer_state_t* out ) const;
+	void load_state( blip_buffer_state_t const& in );
+
 // Experimental features
 
 	// Number of raw samples that can be mixed within frame of specified duration.
@@ -127,25 +139,50 @@ private:
 	#define BLIP_PHASE_BITS 6
 #endif
 
+// // // Define BLIP_BUFFER_NO_SIMD to use only the scalar loops on SSE2 targets.
+#if !defined(BLIP_BUFFER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define BLIP_BUFFER_SSE2
+	#include <emmintrin.h>
+#endif
+
 	// Internal
 	typedef unsigned long blip_resampled_time_t;
 	int const blip_widest_impulse_ = 16;
+	int const blip_buffer_extra_ = blip_widest_impulse_ + 2;		// // //
 	int const blip_res = 1 << BLIP_PHASE_BITS;
 	class blip_eq_t;
 
+	// // // Saved state of a Blip_Buffer, see Blip_Buffer::save_state()
+	struct blip_buffer_state_t
+	{
+		blip_resampled_time_t offset_;
+		long reader_accum_;
+		Blip_Buffer::buf_t_ buf [blip_buffer_extra_];
+	};
+
 	class Blip_Synth_ {
 		double volume_unit_;
 		short* const impulses;
+#ifdef BLIP_BUFFER_SSE2
+		short* const kernels;		// // //
+#endif
 		int const width;
 		long kernel_unit;
 		int impulses_size() const { return blip_res / 2 * width + 1; }
 		void adjust_impulse();
+#ifdef BLIP_BUFFER_SSE2
+		void build_kernels();		// // //
+#endif
 	public:
 		Blip_Buffer* buf;
 		int last_amp;
 		int delta_factor;
 
+#ifdef BLIP_BUFFER_SSE2
+		Blip_Synth_( short* impulses, short* kernels, int width );		// // //
+#else
 		Blip_Synth_( short* impulses, int width );
+#endif
 		void treble_eq( blip_eq_t const& );
 		void volume_unit( double );
 	};
@@ -195,10 +232,18 @@ public:
 	}
 
 public:
+#ifdef BLIP_BUFFER_SSE2
+	explicit Blip_Synth(double range) : impl( impulses, kernels [0], quality ), range_( range < 0. ? -range : range ) { }		// // //
+#else
 	explicit Blip_Synth(double range) : impl( impulses, quality ), range_( range < 0. ? -range : range ) { }		// // //
+#endif
 private:
 	typedef short imp_t;
 	imp_t impulses [blip_res * (quality / 2) + 1];
+#ifdef BLIP_BUFFER_SSE2
+	// // // impulses rearranged so that each phase is contiguous, in buffer order
+	imp_t kernels [blip_res] [quality];
+#endif
 	Blip_Synth_ impl;
 	double range_;
 };
@@ -211,13 +256,17 @@ public:
 	blip_eq_t( double treble_db = 0 );
 
 	// See notes.txt
-	blip_eq_t( double treble, long rolloff_freq, long sample_rate, long cutoff_freq = 0 );
+	// // // Above reference_rate, the response at reference_rate is kept in absolute
+	// frequencies instead of being stretched up to the new half sampling rate.
+	blip_eq_t( double treble, long rolloff_freq, long sample_rate, long cutoff_freq = 0,
+			long reference_rate = 0 );
 
 private:
 	double treble;
 	long rolloff_freq;
 	long sample_rate;
 	long cutoff_freq;
+	long reference_rate;		// // //
 	void generate( float* out, int count ) const;
 	friend class Blip_Synth_;
 };
@@ -260,6 +309,22 @@ const long blip_unscaled = 65535;
 const int blip_low_quality  = blip_med_quality;
 const int blip_best_quality = blip_high_quality;
 
+#ifdef BLIP_BUFFER_SSE2
+// // // Adds four 32-bit values to consecutive buffer samples
+inline void blip_accumulate_( Blip_Buffer::buf_t_* buf, __m128i v )
+{
+	if constexpr ( sizeof (Blip_Buffer::buf_t_) == 8 )
+	{
+		__m128i const sign = _mm_srai_epi32( v, 31 );
+		__m128i* const p = (__m128i*) buf;
+		_mm_storeu_si128( p    , _mm_add_epi64( _mm_loadu_si128( p     ), _mm_unpacklo_epi32( v, sign ) ) );
+		_mm_storeu_si128( p + 1, _mm_add_epi64( _mm_loadu_si128( p + 1 ), _mm_unpackhi_epi32( v, sign ) ) );
+	}
+	else
+		_mm_storeu_si128( (__m128i*) buf, _mm_add_epi32( _mm_loadu_si128( (__m128i const*) buf ), v ) );
+}
+#endif
+
 #define BLIP_FWD( i ) {                     \
 	long t0 = i0 * delta + buf [fwd + i];   \
 	long t1 = imp [blip_res * (i + 1)] * delta + buf [fwd + 1 + i]; \
@@ -290,6 +355,30 @@ inline void Blip_Synth<quality>::offset_resampled( blip_resampled_time_t time,
 	int const fwd = (blip_widest_impulse_ - quality) / 2;
 	int const rev = fwd + quality - 2;
 
+#ifdef BLIP_BUFFER_SSE2		// // //
+	// products of 16-bit deltas fit in 32 bits, larger ones take the scalar path
+	if ( (unsigned) (delta + 0x8000) < 0x10000u )
+	{
+		imp_t const* k = kernels [phase];
+		__m128i const d = _mm_set1_epi16( (short) delta );
+		int i = 0;
+		for ( ; i + 8 <= quality; i += 8 )
+		{
+			__m128i const c = _mm_loadu_si128( (__m128i const*) (k + i) );
+			__m128i const lo = _mm_mullo_epi16( c, d );
+			__m128i const hi = _mm_mulhi_epi16( c, d );
+			blip_accumulate_( buf + fwd + i    , _mm_unpacklo_epi16( lo, hi ) );
+			blip_accumulate_( buf + fwd + i + 4, _mm_unpackhi_epi16( lo, hi ) );
+		}
+		if ( i < quality )
+		{
+			__m128i const c = _mm_loadl_epi64( (__m128i const*) (k + i) );
+			blip_accumulate_( buf + fwd + i, _mm_unpacklo_epi16( _mm_mullo_epi16( c, d ), _mm_mulhi_epi16( c, d ) ) );
+		}
+		return;
+	}
+#endif
+
 	BLIP_FWD( 0 )
 	if constexpr ( quality > 8  ) BLIP_FWD( 2 )		// // //
 	if constexpr ( quality > 12 ) BLIP_FWD( 4 )
@@ -330,9 +419,9 @@ void Blip_Synth<quality>::update( blip_time_t t, int amp )
 }
 
 inline blip_eq_t::blip_eq_t( double t ) :
-		treble( t ), rolloff_freq( 0 ), sample_rate( 44100 ), cutoff_freq( 0 ) { }
-inline blip_eq_t::blip_eq_t( double t, long rf, long sr, long cf ) :
-		treble( t ), rolloff_freq( rf ), sample_rate( sr ), cutoff_freq( cf ) { }
+		treble( t ), rolloff_freq( 0 ), sample_rate( 44100 ), cutoff_freq( 0 ), reference_rate( 0 ) { }
+inline blip_eq_t::blip_eq_t( double t, long rf, long sr, long cf, long ref ) :		// // //
+		treble( t ), rolloff_freq( rf ), sample_rate( sr ), cutoff_freq( cf ), reference_rate( ref ) { }
 
 inline int  Blip_Buffer::length() const         { return length_; }
 inline long Blip_Buffer::samples_avail() const  { return (long) (offset_ >> BLIP_BUFFER_ACCURACY); }
@@ -37,8 +37,10 @@
 #include "Settings.h"		// // //
 #include "APU/APUInterface.h"		// // //
 #include "InstHandler.h"		// // //
+#include "StateArchive.h"		// // //
 #include "NumConv.h"		// // //
 #include <algorithm>		// // //
+#include <utility>		// // //
 
 /*
  * Class CChannelHandler
@@ -49,6 +51,7 @@ CChannelHandler::CChannelHandler(stChannelID ch, int MaxPeriod, int MaxVolume) :
 	m_iChannelID(ch),		// // //
 	m_iVibratoMode(CFamiTrackerModule::DEFAULT_VIBRATO_STYLE),		// // //
 	m_iInstTypeCurrent(INST_NONE),		// // //
+	m_iInstTypeHandler(INST_NONE),		// // //
 	m_iMaxPeriod(MaxPeriod),
 	m_iMaxVolume(MaxVolume)
 {
@@ -133,6 +136,7 @@ void CChannelHandler::ResetChannel()
 	// Instrument
 	m_iInstrument		= MAX_INSTRUMENTS;
 	m_iInstTypeCurrent	= INST_NONE;		// // //
+	m_iInstTypeHandler	= INST_NONE;		// // //
 	m_pInstHandler.reset();		// // //
 
 	// Volume
@@ -216,6 +220,33 @@ void CChannelHandler::ApplyChannelState(const stChannelState &State)
 		HandleEffect({effect_t::FDS_MOD_DEPTH, static_cast<uint8_t>(State.Effect_AutoFMMult)});
 }
 
+void CChannelHandler::SerializeState(CStateArchive &ar)		// // //
+{
+	ar(m_bTrigger, m_bRelease, m_bGate, m_iInstrument, m_bForceReload, m_iNote, m_iActiveNote, m_iPeriod,
+		m_iInstVolume, m_iVolume, m_iDutyPeriod, m_iEchoBuffer, m_bDelayEnabled, m_cDelayCounter, m_cnDelayed,
+		m_iVibratoDepth, m_iVibratoSpeed, m_iVibratoPhase, m_iTremoloDepth, m_iTremoloSpeed, m_iTremoloPhase,
+		m_iEffect, m_iEffectParam, m_iArpState, m_iPortaTo, m_iPortaSpeed, m_iNoteCut, m_iNoteRelease,
+		m_iNoteVolume, m_iDefaultVolume, m_iNewVolume, m_iTranspose, m_bTransposeDown, m_iTransposeTarget,
+		m_iFinePitch, m_iDefaultDuty, m_iVolSlide, m_iPitch, m_iInstTypeCurrent);
+
+	// a different instrument handler is created the same way HandleInstrument would
+	inst_type_t HandlerType = m_pInstHandler ? m_iInstTypeHandler : INST_NONE;
+	ar(HandlerType);
+	if (ar.IsLoading()) {
+		if (HandlerType == INST_NONE)
+			m_pInstHandler.reset();
+		else if (!m_pInstHandler || HandlerType != m_iInstTypeHandler) {
+			const inst_type_t Current = std::exchange(m_iInstTypeCurrent, INST_NONE);
+			m_pInstHandler.reset();
+			CreateInstHandler(HandlerType);
+			m_iInstTypeCurrent = Current;
+		}
+		m_iInstTypeHandler = HandlerType;
+	}
+	if (m_pInstHandler)
+		m_pInstHandler->SerializeState(ar);
+}
+
 std::string CChannelHandler::GetEffectString() const		// // //
 {
 	std::string str = GetSlideEffectString();
@@ -430,8 +461,8 @@ bool CChannelHandler::HandleInstrument(bool Trigger, bool NewInstrument)		// //
 
 	// load instrument here
 	inst_type_t instType = pInstrument->GetType();
-	if (NewInstrument)
-		CreateInstHandler(instType);
+	if (NewInstrument && CreateInstHandler(instType))
+		m_iInstTypeHandler = instType;		// // //
 	m_iInstTypeCurrent = instType;
 
 	if (!m_pInstHandler)
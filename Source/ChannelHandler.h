@@ -42,6 +42,7 @@ class CAPUInterface;		// // //
 class stChannelState;
 class CSoundGenBase;		// // //
 class CFamiTrackerModule;		// // //
+class CStateArchive;		// // //
 
 enum inst_type_t : unsigned;		// // //
 enum class vibrato_t : std::uint8_t;		// // //
@@ -114,6 +115,12 @@ public:
 		\param A channel state object.
 		\sa CSoundGen::ApplyGlobalState */
 	virtual void	ApplyChannelState(const stChannelState &State);	// // //
+	/*!	\brief Stores or restores the channel handler's playback state, including the state of its
+		instrument handler.
+		\details Settings derived from the module, such as the note lookup table, are not part of
+		the state. Overrides in subclasses must call the superclass method first.
+		\param ar The state archive. */
+	virtual void	SerializeState(CStateArchive &ar);		// // //
 
 	/*!	\brief Sets the channel handler's note lookup table.
 		\param pNoteLookupTable View into the note lookup table. */
@@ -510,6 +517,8 @@ protected:
 		instruments not native to the current sound channel.
 		\sa CChannelHandler::ConvertDuty */
 	inst_type_t		m_iInstTypeCurrent;
+	/*!	\brief The instrument type that the current instrument handler was created for. */
+	inst_type_t		m_iInstTypeHandler;		// // //
 	/*!	\brief A pointer to the currently installed instrument handler. */
 	std::unique_ptr<CInstHandler>	m_pInstHandler;				// // //
 
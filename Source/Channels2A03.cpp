@@ -25,13 +25,13 @@
 #include "Channels2A03.h"
 #include "APU/Types.h"		// // //
 #include "APU/APUInterface.h"		// // //
-#include "APU/2A03.h"		// // // for DPCM
 #include "ft0cc/doc/dpcm_sample.hpp"		// // //
 #include "Instrument.h"		// // //
 #include "InstHandler.h"		// // //
 #include "SeqInstHandler.h"		// // //
 #include "InstHandlerDPCM.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 #ifndef FT0CC_EXT_BUILD
 #include "FamiTrackerEnv.h"		// // //
 #include "Settings.h"
@@ -49,6 +49,12 @@ CChannelHandler2A03::CChannelHandler2A03(stChannelID ch) :		// // //
 {
 }
 
+void CChannelHandler2A03::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bHardwareEnvelope, m_bEnvelopeLoop, m_bResetEnvelope, m_iLengthCounter);
+}
+
 void CChannelHandler2A03::HandleNoteData(stChanNote &NoteData)		// // //
 {
 	// // //
@@ -146,6 +152,12 @@ C2A03Square::C2A03Square(stChannelID ch) :		// // //
 {
 }
 
+void C2A03Square::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler2A03::SerializeState(ar);
+	ar(m_cSweep, m_bSweeping, m_iSweep, m_iLastPeriod);
+}
+
 void C2A03Square::RefreshChannel()
 {
 	int Period = CalculatePeriod();
@@ -277,6 +289,12 @@ CTriangleChan::CTriangleChan(stChannelID ch) :		// // //
 {
 }
 
+void CTriangleChan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler2A03::SerializeState(ar);
+	ar(m_iLinearCounter);
+}
+
 void CTriangleChan::RefreshChannel()
 {
 	int Freq = CalculatePeriod();
@@ -509,6 +527,13 @@ CDPCMChan::CDPCMChan(stChannelID ch) :		// // //
 {
 }
 
+void CDPCMChan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_cDAC, m_iLoop, m_iOffset, m_iSampleLength, m_iLoopOffset, m_iLoopLength,
+		m_iRetrigger, m_iRetriggerCntr, m_iCustomPitch, m_bRetrigger, m_bEnabled);
+}
+
 void CDPCMChan::HandleNoteData(stChanNote &NoteData)		// // //
 {
 	m_iCustomPitch = -1;
@@ -672,8 +697,7 @@ void CDPCMChan::SetLoopOffset(unsigned char Loop)		// // //
 void CDPCMChan::PlaySample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSamp, int Pitch)		// // //
 {
 	int SampleSize = pSamp->size();
-	if (auto *p2A03 = dynamic_cast<C2A03 *>(m_pAPU->GetSoundChip(sound_chip_t::APU)))
-		p2A03->WriteSample(std::move(pSamp));		// // //
+	m_pAPU->WriteSample(std::move(pSamp));		// // //
 	m_iPeriod = m_iCustomPitch != -1 ? m_iCustomPitch : Pitch;
 	m_iSampleLength = (SampleSize >> 4) - (m_iOffset << 2);
 	m_iLoopLength = SampleSize - m_iLoopOffset;
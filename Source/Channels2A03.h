@@ -32,6 +32,7 @@
 class CChannelHandler2A03 : public CChannelHandler {
 public:
 	explicit CChannelHandler2A03(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	virtual void ResetChannel();
 
 protected:
@@ -54,6 +55,7 @@ protected:
 class C2A03Square : public CChannelHandler2A03 {
 public:
 	explicit C2A03Square(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	RefreshChannel() override;
 protected:
 	int		ConvertDuty(int Duty) const override;		// // //
@@ -75,6 +77,7 @@ protected:
 class CTriangleChan : public CChannelHandler2A03 {
 public:
 	explicit CTriangleChan(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	RefreshChannel() override;
 	void	ResetChannel() override;		// // //
 	int		GetChannelVolume() const override;		// // //
@@ -111,6 +114,7 @@ class dpcm_sample;
 class CDPCMChan : public CChannelHandler, public CChannelHandlerInterfaceDPCM {		// // //
 public:
 	explicit CDPCMChan(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	RefreshChannel() override;
 	int		GetChannelVolume() const override;		// // //
 
@@ -32,12 +32,21 @@
 #include "FamiTrackerEnv.h"		// // //
 #include "Settings.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 
 CChannelHandlerFDS::CChannelHandlerFDS(stChannelID ch) :		// // //
 	CChannelHandlerInverted(ch, 0xFFF, 32)
 {
 }
 
+void CChannelHandlerFDS::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandlerInverted::SerializeState(ar);
+	ar(m_iModulationSpeed, m_iModulationDepth, m_iModulationDelay, m_iWaveTable, m_iModTable,
+		m_iVolModMode, m_iVolModRate, m_bVolModTrigger, m_bAutoModulation,
+		m_iModulationOffset, m_iEffModDepth, m_iEffModSpeedHi, m_iEffModSpeedLo);
+}
+
 void CChannelHandlerFDS::HandleNoteData(stChanNote &NoteData)		// // //
 {
 	m_iEffModDepth = -1;
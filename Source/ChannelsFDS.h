@@ -29,6 +29,7 @@
 class CChannelHandlerFDS : public CChannelHandlerInverted, public CChannelHandlerInterfaceFDS {
 public:
 	explicit CChannelHandlerFDS(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	RefreshChannel() override;
 protected:
 	void	HandleNoteData(stChanNote &pNoteData) override;		// // //
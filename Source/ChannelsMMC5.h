@@ -32,6 +32,7 @@
 class CChannelHandlerMMC5 : public CChannelHandler {
 public:
 	explicit CChannelHandlerMMC5(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	ResetChannel() override;
 	void	RefreshChannel() override;
 
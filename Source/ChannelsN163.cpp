@@ -31,6 +31,7 @@
 #include "SongState.h"		// // //
 #include "FamiTrackerModule.h"		// // //
 #include "Assertion.h"		// // //
+#include "StateArchive.h"		// // //
 
 const int N163_PITCH_SLIDE_SHIFT = 2;	// Increase amplitude of pitch slides
 
@@ -44,6 +45,13 @@ CChannelHandlerN163::CChannelHandlerN163(stChannelID ch) :		// / //
 	m_iDutyPeriod = 0;
 }
 
+void CChannelHandlerN163::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandlerInverted::SerializeState(ar);
+	ar(m_bLoadWave, m_bDisableLoad, m_iChannels, m_iWaveLen, m_iWavePos, m_iWavePosOld, m_iWaveCount,
+		m_bResetPhase);
+}
+
 void CChannelHandlerN163::ResetChannel()
 {
 	CChannelHandler::ResetChannel();
@@ -32,6 +32,7 @@
 class CChannelHandlerN163 : public CChannelHandlerInverted, public CChannelHandlerInterfaceN163 {
 public:
 	explicit CChannelHandlerN163(stChannelID ch);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	RefreshChannel() override;
 	void	ResetChannel() override;
 
@@ -30,6 +30,7 @@
 #include "InstHandler.h"		// // //
 #include "SeqInstHandlerS5B.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 
 // Class functions
 
@@ -59,6 +60,12 @@ CChannelHandlerS5B::CChannelHandlerS5B(stChannelID ch, CChipHandlerS5B &parent)
 	m_iDefaultDuty = value_cast(s5b_mode_t::Square);		// // //
 }
 
+void CChannelHandlerS5B::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bEnvelopeEnabled, m_iAutoEnvelopeShift, m_bUpdate);
+}
+
 bool CChannelHandlerS5B::HandleEffect(stEffectCommand cmd)
 {
 	switch (cmd.fx) {
@@ -34,6 +34,7 @@ class CChipHandlerS5B;		// // //
 class CChannelHandlerS5B : public CChannelHandler, public CChannelHandlerInterfaceS5B {
 public:
 	CChannelHandlerS5B(stChannelID ch, CChipHandlerS5B &parent);		// / //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	void	ResetChannel() override;
 	void	RefreshChannel() override;
 
@@ -29,6 +29,7 @@
 #include "InstHandler.h"		// // //
 #include "InstHandlerVRC7.h"		// // //
 #include "ChipHandlerVRC7.h"		// // //
+#include "StateArchive.h"		// // //
 
 namespace {
 
@@ -46,6 +47,12 @@ CChannelHandlerVRC7::CChannelHandlerVRC7(stChannelID ch, CChipHandlerVRC7 &paren
 	m_iVolume = VOL_COLUMN_MAX;
 }
 
+void CChannelHandlerVRC7::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandlerInverted::SerializeState(ar);
+	ar(m_iTriggeredNote, m_iOctave, m_iOldOctave, m_iCustomPort, m_iCommand, m_iPatch, m_bHold);
+}
+
 void CChannelHandlerVRC7::SetPatch(unsigned char Patch)		// // //
 {
 	m_iDutyPeriod = Patch;
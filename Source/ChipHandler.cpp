@@ -35,6 +35,9 @@ void CChipHandler::RefreshBefore(CAPUInterface &) {
 void CChipHandler::RefreshAfter(CAPUInterface &) {
 }
 
+void CChipHandler::SerializeState(CStateArchive &) {		// // //
+}
+
 void CChipHandler::AddChannelHandler(std::unique_ptr<CChannelHandler> ch) {
 	channels_.push_back(std::move(ch));
 }
@@ -23,6 +23,7 @@
 #include "ChipHandlerVRC7.h"
 #include "ChannelsVRC7.h"
 #include "APU/APUInterface.h"
+#include "StateArchive.h"		// // //
 #include <iterator>
 
 void CChipHandlerVRC7::SetPatchReg(unsigned index, uint8_t val) {
@@ -60,3 +61,7 @@ void CChipHandlerVRC7::RefreshAfter(CAPUInterface &apu) {
 	}
 	patch_mask_ = 0u;
 }
+
+void CChipHandlerVRC7::SerializeState(CStateArchive &ar) {		// // //
+	ar(patch_, patch_mask_, dirty_);
+}
@@ -31,6 +31,13 @@ enum class decay_rate_t {		// // // 050B
 	Fast,
 };
 
+// // // width of the band-limited steps, wider steps alias less but cost more
+enum class synth_quality_t {
+	Fast,		// 8 points, for previews
+	Good,		// 12 points, the default
+	High,		// 16 points, for final renders
+};
+
 // Used to get the DPCM state
 struct stDPCMState {
 	int SamplePos;
@@ -41,5 +48,6 @@ struct stDPCMState {
 class IAudioCallback {
 public:
 	virtual void FlushBuffer(array_view<int16_t> Buffer) = 0;		// // //
+	virtual void FlushBuffer(array_view<float> Buffer) = 0;		// // // only if the APU was set up for float output
 	virtual bool PlayBuffer() = 0;		// // // return true if succeeded
 };
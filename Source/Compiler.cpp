@@ -49,6 +49,7 @@
 #include "SoundChipService.h"		// // //
 #include "SimpleFile.h"		// // //
 #include "Assertion.h"		// // //
+#include "TraceRecorder.h"		// // //
 
 //
 // This is the new NSF data compiler, music is compiled to an object list instead of a binary chunk
@@ -710,6 +711,8 @@ void CCompiler::EnableBankswitching()
 
 void CCompiler::ResolveLabels()
 {
+	CTraceScope scope {"Resolve labels", "compiler"};		// // //
+
 	// Resolve label addresses, no banks since bankswitching is disabled
 	std::map<stChunkLabel, int> labelMap;		// // //
 
@@ -722,6 +725,8 @@ void CCompiler::ResolveLabels()
 
 bool CCompiler::ResolveLabelsBankswitched()
 {
+	CTraceScope scope {"Resolve labels", "compiler"};		// // //
+
 	// Resolve label addresses and banks
 	std::map<stChunkLabel, int> labelMap;		// // //
 
@@ -821,6 +826,8 @@ void CCompiler::AssignLabels(std::map<stChunkLabel, int> &labelMap)		// // //
 
 bool CCompiler::CompileData()
 {
+	CTraceScope scope {"Compile data", "compiler"};		// // //
+
 	// Compile music data to an object tree
 	//
 
@@ -1483,6 +1490,9 @@ void CCompiler::CreateFrameList(unsigned int Track)
 
 void CCompiler::StorePatterns(unsigned int Track)
 {
+	CTraceScope scope {"Store patterns", "compiler"};		// // //
+	scope.SetArg(0, "track", Track);
+
 	/*
 	 * Store patterns and save references to them for the frame list
 	 *
@@ -46,6 +46,7 @@ const LPCWSTR CConfigGeneral::CONFIG_STR[] = {		// // //
 	L"Cut sub-volume",
 	L"Use old FDS volume table",
 	L"Retrieve channel state",
+	L"Checkpoint playback start",
 	L"Overflow paste mode",
 	L"Show skipped rows",
 	L"Hexadecimal keypad",
@@ -72,6 +73,7 @@ const LPCWSTR CConfigGeneral::CONFIG_DESC[] = {		// // //
 	L"Always silent volume values below 1 due to Axy or 7xy effects.",
 	L"Use the existing volume table for the FDS channel which has higher precision than in exported NSFs.",
 	L"Reconstruct the current channel's state from previous frames upon playing (except when playing one row).",
+	L"Play the song silently in the background while stopped, so that playback can start anywhere with the exact state it has when the song is played from the beginning.",
 	L"Move pasted pattern data outside the rows of the current frame to subsequent frames.",
 	L"Display rows that are truncated by Bxx, Cxx, or Dxx effects.",
 	L"Use the extra keys on the keypad as hexadecimal digits in the pattern editor.",
@@ -158,6 +160,7 @@ BOOL CConfigGeneral::OnApply()
 	pSettings->General.bCutVolume			= m_bCutVolume;
 	pSettings->General.bFDSOldVolume		= m_bFDSOldVolume;
 	pSettings->General.bRetrieveChanState	= m_bRetrieveChanState;
+	pSettings->General.bCheckpointSeek		= m_bCheckpointSeek;		// // //
 	pSettings->General.bOverflowPaste		= m_bOverflowPaste;
 	pSettings->General.bShowSkippedRows		= m_bShowSkippedRows;
 	pSettings->General.bHexKeypad			= m_bHexKeypad;
@@ -204,6 +207,7 @@ BOOL CConfigGeneral::OnInitDialog()
 	m_bCutVolume			= pSettings->General.bCutVolume;
 	m_bFDSOldVolume			= pSettings->General.bFDSOldVolume;
 	m_bRetrieveChanState	= pSettings->General.bRetrieveChanState;
+	m_bCheckpointSeek		= pSettings->General.bCheckpointSeek;		// // //
 	m_bOverflowPaste		= pSettings->General.bOverflowPaste;
 	m_bShowSkippedRows		= pSettings->General.bShowSkippedRows;
 	m_bHexKeypad			= pSettings->General.bHexKeypad;
@@ -262,6 +266,7 @@ BOOL CConfigGeneral::OnInitDialog()
 		m_bCutVolume,
 		m_bFDSOldVolume,
 		m_bRetrieveChanState,
+		m_bCheckpointSeek,
 		m_bOverflowPaste,
 		m_bShowSkippedRows,
 		m_bHexKeypad,
@@ -333,6 +338,7 @@ void CConfigGeneral::OnLvnItemchangedConfigList(NMHDR *pNMHDR, LRESULT *pResult)
 		&CConfigGeneral::m_bCutVolume,
 		&CConfigGeneral::m_bFDSOldVolume,
 		&CConfigGeneral::m_bRetrieveChanState,
+		&CConfigGeneral::m_bCheckpointSeek,
 		&CConfigGeneral::m_bOverflowPaste,
 		&CConfigGeneral::m_bShowSkippedRows,
 		&CConfigGeneral::m_bHexKeypad,
@@ -26,7 +26,7 @@
 #include "stdafx.h"		// // //
 #include "../resource.h"		// // //
 
-inline constexpr std::size_t SETTINGS_BOOL_COUNT = 23u;		// // //
+inline constexpr std::size_t SETTINGS_BOOL_COUNT = 24u;		// // //
 
 // CConfigGeneral dialog
 
@@ -62,6 +62,7 @@ protected:
 	bool	m_bCutVolume;
 	bool	m_bFDSOldVolume;
 	bool	m_bRetrieveChanState;
+	bool	m_bCheckpointSeek;		// // //
 	bool	m_bOverflowPaste;
 	bool	m_bShowSkippedRows;
 	bool	m_bHexKeypad;
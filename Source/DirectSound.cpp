@@ -28,6 +28,7 @@
 #include "Common.h"
 #include "../resource.h"
 #include "str_conv/str_conv.hpp"		// // //
+#include <algorithm>		// // //
 
 // Class members
 
@@ -278,15 +279,24 @@ bool CDSoundChannel::WriteBuffer(array_view<char> Buffer)		// // //
 	DWORD AudioBytes1, AudioBytes2;
 	int	  Block = m_iCurrentWriteBlock;
 
-	ASSERT(Buffer.size() == m_iBlockSize);
+	ASSERT(Buffer.size() <= m_iBlockSize);		// // //
 
 	if (FAILED(m_lpDirectSoundBuffer->Lock(Block * m_iBlockSize, m_iBlockSize, (void**)&pAudioPtr1, &AudioBytes1, (void**)&pAudioPtr2, &AudioBytes2, 0)))
 		return false;
 
-	std::memcpy(pAudioPtr1, Buffer.data(), AudioBytes1);
+	// // // the last block of a render may be short, the rest of it is silence
+	const int Silence = m_iSampleSize == 8 ? 0x80 : 0x00;
+	auto Copy = [&] (void *pDest, DWORD Bytes, std::size_t Offset) {
+		std::size_t Count = Offset < Buffer.size() ? std::min<std::size_t>(Bytes, Buffer.size() - Offset) : 0u;
+		if (Count)
+			std::memcpy(pDest, Buffer.data() + Offset, Count);
+		std::memset(static_cast<char *>(pDest) + Count, Silence, Bytes - Count);
+	};
+
+	Copy(pAudioPtr1, AudioBytes1, 0u);
 
 	if (pAudioPtr2)
-		std::memcpy(pAudioPtr2, Buffer.data() + AudioBytes1, AudioBytes2);
+		Copy(pAudioPtr2, AudioBytes2, AudioBytes1);
 
 	if (FAILED(m_lpDirectSoundBuffer->Unlock((void*)pAudioPtr1, AudioBytes1, (void*)pAudioPtr2, AudioBytes2)))
 		return false;
@@ -296,7 +306,7 @@ bool CDSoundChannel::WriteBuffer(array_view<char> Buffer)		// // //
 	return true;
 }
 
-buffer_event_t CDSoundChannel::WaitForSyncEvent(DWORD dwTimeout) const
+buffer_event_t CDSoundChannel::WaitForSyncEvent(std::uint32_t dwTimeout) const		// // //
 {
 	// Wait for a DirectSound event
 	if (!IsPlaying()) {
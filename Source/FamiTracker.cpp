@@ -44,6 +44,8 @@
 #include <iostream>		// // //
 #include "str_conv/str_conv.hpp"		// // //
 #include "NumConv.h"		// // //
+#include "FamiTrackerEnv.h"		// // //
+#include "TraceRecorder.h"		// // //
 
 #include <afxadv.h>		// // // CRecentFileList
 #if !defined(WIP) && !defined(_DEBUG)		// // //
@@ -112,6 +114,7 @@ BOOL CFamiTrackerApp::InitInstance()
 	CWinApp::InitInstance();
 
 	TRACE(L"App: InitInstance\n");
+	FTEnv.GetTraceRecorder()->SetThreadName("Main");		// // //
 
 	if (!AfxOleInit()) {
 		TRACE(L"OLE initialization failed\n");
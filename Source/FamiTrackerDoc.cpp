@@ -213,6 +213,10 @@ void CFamiTrackerDoc::SetModifiedFlag(BOOL bModified)
 	BOOL bWasModified = IsModified();
 	CDocument::SetModifiedFlag(bModified);
 
+	if (bModified)		// // // snapshots of the old module are no longer valid
+		if (CSoundGen *pSoundGen = FTEnv.GetSoundGenerator())
+			pSoundGen->InvalidateCheckpoints();
+
 	if (auto *pFrameWnd = dynamic_cast<CFrameWnd *>(FTEnv.GetMainApp()->m_pMainWnd))		// // //
 		if (pFrameWnd->GetActiveDocument() == this && bWasModified != bModified)
 			pFrameWnd->OnUpdateFrameTitle(TRUE);
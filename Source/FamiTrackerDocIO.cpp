@@ -31,6 +31,7 @@
 #include "str_conv/str_conv.hpp"
 #include "NumConv.h"
 #include "Assertion.h"
+#include "TraceRecorder.h"		// // //
 
 #include "FamiTrackerEnv.h"
 #include "SoundChipService.h"
@@ -136,6 +137,8 @@ bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
 		{FILE_BLOCK_BOOKMARKS,		&CFamiTrackerDocIO::LoadBookmarks},		// // //
 	};
 
+	CTraceScope scope {"Load module", "module"};		// // //
+
 	// This has to be done for older files
 	if (file_.GetFileVersion() < 0x0210)
 		(void)modfile.GetSong(0);
@@ -149,9 +152,11 @@ bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
 			break;
 
 		try {
+			auto it = FTM_READ_FUNC.find(BlockID);		// // // block names are literals
+			CTraceScope blockScope {it != FTM_READ_FUNC.end() ? it->first.data() : "Unknown block", "module"};
 			(this->*FTM_READ_FUNC.at(BlockID))(modfile, file_.GetBlockVersion());		// // //
 		}
-		catch (std::out_of_range) {
+		catch (std::out_of_range &) {
 			DEBUG_BREAK();
 			if (file_.IsFileIncomplete())
 				ErrorFlag = true;
@@ -186,8 +191,10 @@ bool CFamiTrackerDocIO::Save(const CFamiTrackerModule &modfile) {
 		{&CFamiTrackerDocIO::SaveBookmarks,		1, FILE_BLOCK_BOOKMARKS},			// // //
 	};
 
+	CTraceScope scope {"Save module", "module"};		// // //
 	file_.BeginDocument();
 	for (auto [fn, ver, name] : MODULE_WRITE_FUNC) {
+		CTraceScope blockScope {name.data(), "module"};		// // //
 		file_.CreateBlock(name.data(), ver);
 		(this->*fn)(modfile, ver);
 		if (!file_.FlushBlock())
@@ -23,6 +23,8 @@
 #include "FamiTrackerEnv.h"
 #include "InstrumentService.h"		// // //
 #include "SoundChipService.h"		// // //
+#include "Settings.h"		// // //
+#include "TraceRecorder.h"		// // //
 #ifndef FT0CC_EXT_BUILD
 #include "stdafx.h"
 #include "FamiTracker.h"
@@ -72,7 +74,7 @@ CMIDI *CFamiTrackerEnv::GetMIDI() {
 
 CSettings *CFamiTrackerEnv::GetSettings() {
 #ifdef FT0CC_EXT_BUILD
-	return nullptr;
+	return &CSettings::GetInstance();		// // // defaults only
 #else
 	return theApp.GetSettings();
 #endif
@@ -96,6 +98,11 @@ CSoundChipService *CFamiTrackerEnv::GetSoundChipService() {
 	return &factory;
 }
 
+CTraceRecorder *CFamiTrackerEnv::GetTraceRecorder() {		// // //
+	static CTraceRecorder recorder;
+	return &recorder;
+}
+
 bool CFamiTrackerEnv::IsFileLoaded() {
 #ifdef FT0CC_EXT_BUILD
 	return false;
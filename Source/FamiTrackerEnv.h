@@ -33,6 +33,7 @@ class CMIDI;
 class CSettings;
 class CInstrumentService;
 class CSoundChipService;
+class CTraceRecorder;		// // //
 
 // global tracker environment
 
@@ -45,6 +46,7 @@ struct CFamiTrackerEnv {
 	static CSettings	*GetSettings();
 	static CInstrumentService *GetInstrumentService();		// // //
 	static CSoundChipService *GetSoundChipService();		// // //
+	static CTraceRecorder *GetTraceRecorder();		// // //
 
 	static bool IsFileLoaded();
 	static std::string GetDocumentTitle();
@@ -0,0 +1,152 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "FrameProfiler.h"
+#include <algorithm>
+
+void CFrameProfiler::BeginFrame() {
+	// drop whatever ran outside of a frame, or in a frame that was never ended
+	m_iFrameTime = { };
+	m_bFrameUsed = { };
+	m_tFrameStart = clock_t::now();
+}
+
+void CFrameProfiler::EndFrame() {
+	Add(profile_section_t::Frame, sound_chip_t::none, clock_t::now() - m_tFrameStart);
+
+	std::lock_guard<std::mutex> lock {m_StatsLock};
+	for (std::size_t i = 0; i < SLOT_COUNT; ++i)
+		if (m_bFrameUsed[i]) {
+			m_Histograms[i].Add(m_iFrameTime[i]);
+			m_iFrameTime[i] = 0u;
+			m_bFrameUsed[i] = false;
+		}
+}
+
+void CFrameProfiler::Add(profile_section_t Section, sound_chip_t Chip, clock_t::duration Time) {
+	std::size_t Slot = GetSlot(Section, Chip);
+	m_iFrameTime[Slot] += std::chrono::duration_cast<std::chrono::nanoseconds>(Time).count();
+	m_bFrameUsed[Slot] = true;
+}
+
+void CFrameProfiler::Reset() {
+	std::lock_guard<std::mutex> lock {m_StatsLock};
+	m_Histograms = { };
+}
+
+stProfileStats CFrameProfiler::GetStats(profile_section_t Section, sound_chip_t Chip) const {
+	std::lock_guard<std::mutex> lock {m_StatsLock};
+	const CHistogram &h = m_Histograms[GetSlot(Section, Chip)];
+
+	stProfileStats stats;
+	stats.Frames = h.GetCount();
+	stats.Mean = h.GetMean() / 1000.;
+	stats.P50 = h.GetPercentile(.5) / 1000.;
+	stats.P99 = h.GetPercentile(.99) / 1000.;
+	stats.Max = h.GetMax() / 1000.;
+	return stats;
+}
+
+const char *CFrameProfiler::GetSectionName(profile_section_t Section) {
+	switch (Section) {
+	case profile_section_t::Frame:          return "Frame";
+	case profile_section_t::DriverTick:     return "Sound driver tick";
+	case profile_section_t::ProcessChannel: return "Process channels";
+	case profile_section_t::RefreshChannel: return "Refresh channels";
+	case profile_section_t::ChipProcess:    return "Chip emulation";
+	case profile_section_t::ChipEndFrame:   return "Chip end of frame";
+	case profile_section_t::MixerFinish:    return "Mixer";
+	case profile_section_t::AudioFlush:     return "Audio output";
+	}
+	return "";
+}
+
+bool CFrameProfiler::IsPerChip(profile_section_t Section) {
+	switch (Section) {
+	case profile_section_t::ProcessChannel:
+	case profile_section_t::RefreshChannel:
+	case profile_section_t::ChipProcess:
+	case profile_section_t::ChipEndFrame:
+		return true;
+	default:
+		return false;
+	}
+}
+
+std::size_t CFrameProfiler::GetSlot(profile_section_t Section, sound_chip_t Chip) {
+	std::size_t ChipSlot = Chip == sound_chip_t::none ? CHIP_SLOTS - 1 : value_cast(Chip);
+	return value_cast(Section) * CHIP_SLOTS + ChipSlot;
+}
+
+
+
+void CFrameProfiler::CHistogram::Add(std::uint64_t Value) {
+	std::size_t Bucket = GetBucket(Value);
+	if (buckets_.size() <= Bucket)
+		buckets_.resize(Bucket + 1);
+	++buckets_[Bucket];
+	++count_;
+	max_ = std::max(max_, Value);
+	sum_ += static_cast<double>(Value);
+}
+
+std::uint64_t CFrameProfiler::CHistogram::GetPercentile(double Fraction) const {
+	if (!count_)
+		return 0u;
+	auto Rank = static_cast<std::uint64_t>(Fraction * static_cast<double>(count_ - 1));
+	std::uint64_t Seen = 0u;
+	for (std::size_t i = 0; i < buckets_.size(); ++i)
+		if ((Seen += buckets_[i]) > Rank)
+			return std::min(GetBucketLimit(i), max_);
+	return max_;
+}
+
+std::uint64_t CFrameProfiler::CHistogram::GetCount() const {
+	return count_;
+}
+
+std::uint64_t CFrameProfiler::CHistogram::GetMax() const {
+	return max_;
+}
+
+double CFrameProfiler::CHistogram::GetMean() const {
+	return count_ ? sum_ / static_cast<double>(count_) : 0.;
+}
+
+// values below 8 have a bucket each, above that every power of two is split into 8
+std::size_t CFrameProfiler::CHistogram::GetBucket(std::uint64_t Value) {
+	if (Value < 8u)
+		return static_cast<std::size_t>(Value);
+	unsigned Octave = 0u;
+	while (Value >> (Octave + 1))
+		++Octave;
+	return static_cast<std::size_t>(8u * (Octave - 2) + ((Value >> (Octave - 3)) & 7u));
+}
+
+// largest value that falls into the bucket
+std::uint64_t CFrameProfiler::CHistogram::GetBucketLimit(std::size_t Bucket) {
+	if (Bucket < 8u)
+		return Bucket;
+	unsigned Octave = static_cast<unsigned>(Bucket / 8u) + 2u;
+	std::uint64_t Sub = Bucket % 8u;
+	return ((8u + Sub + 1u) << (Octave - 3)) - 1u;
+}
@@ -0,0 +1,135 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include "APU/Types.h"
+
+// // // per-frame timing of the emulation
+//
+// Each instrumented call adds its duration to a section of the current frame;
+// at the end of the frame every section that ran adds its total to a histogram,
+// from which the per-frame percentiles are read. Sections can nest: the sound
+// driver tick contains the channel updates, and the chips also run inside the
+// tick whenever a register is written. Profiling is off when objects are given
+// no profiler, which costs one pointer test per instrumented call.
+
+ENUM_CLASS_STANDARD(profile_section_t, std::uint8_t) {
+	Frame,				// the whole frame, minus waiting for the audio device
+	DriverTick,			// CSoundDriver::Tick
+	ProcessChannel,		// CChannelHandler::ProcessChannel, per chip
+	RefreshChannel,		// CChannelHandler::RefreshChannel, per chip
+	ChipProcess,		// CSoundChip::Process, per chip
+	ChipEndFrame,		// CSoundChip::EndFrame, per chip
+	MixerFinish,		// CMixer::FinishBuffer
+	AudioFlush,			// reading the mixer and handing the samples to the output
+	min = Frame, max = AudioFlush, none = static_cast<std::uint8_t>(-1),
+};
+
+// times are in microseconds per frame
+struct stProfileStats {
+	std::uint64_t Frames = 0u;		// frames in which the section ran
+	double Mean = 0.;
+	double P50 = 0.;
+	double P99 = 0.;
+	double Max = 0.;
+};
+
+class CFrameProfiler {
+public:
+	using clock_t = std::chrono::steady_clock;
+
+	// called from the thread running the emulation
+	void BeginFrame();
+	void EndFrame();
+	void Add(profile_section_t Section, sound_chip_t Chip, clock_t::duration Time);
+
+	// may be called from any thread
+	void Reset();
+	stProfileStats GetStats(profile_section_t Section, sound_chip_t Chip = sound_chip_t::none) const;
+
+	static const char *GetSectionName(profile_section_t Section);
+	static bool IsPerChip(profile_section_t Section);
+
+private:
+	// sections that are not per chip use the last slot
+	static constexpr std::size_t CHIP_SLOTS = SOUND_CHIP_COUNT + 1;
+	static constexpr std::size_t SLOT_COUNT = enum_count<profile_section_t>() * CHIP_SLOTS;
+	static std::size_t GetSlot(profile_section_t Section, sound_chip_t Chip);
+
+	// log-linear buckets, 8 per power of two, so percentiles are within 1/8 of the value
+	class CHistogram {
+	public:
+		void Add(std::uint64_t Value);
+		std::uint64_t GetPercentile(double Fraction) const;
+		std::uint64_t GetCount() const;
+		std::uint64_t GetMax() const;
+		double GetMean() const;
+
+	private:
+		static std::size_t GetBucket(std::uint64_t Value);
+		static std::uint64_t GetBucketLimit(std::size_t Bucket);
+
+		std::vector<std::uint32_t> buckets_;		// allocated on the first sample
+		std::uint64_t count_ = 0u;
+		std::uint64_t max_ = 0u;
+		double sum_ = 0.;
+	};
+
+	clock_t::time_point m_tFrameStart;
+	std::array<std::uint64_t, SLOT_COUNT> m_iFrameTime = { };		// nanoseconds
+	std::array<bool, SLOT_COUNT> m_bFrameUsed = { };
+
+	mutable std::mutex m_StatsLock;
+	std::array<CHistogram, SLOT_COUNT> m_Histograms;
+};
+
+// // // times the enclosing scope into a section, does nothing without a profiler
+class CProfileScope {
+public:
+	CProfileScope(CFrameProfiler *pProfiler, profile_section_t Section, sound_chip_t Chip = sound_chip_t::none) noexcept :
+		m_pProfiler(pProfiler), m_iSection(Section), m_iChip(Chip)
+	{
+		if (m_pProfiler)
+			m_tStart = CFrameProfiler::clock_t::now();
+	}
+	~CProfileScope() noexcept {
+		if (m_pProfiler)
+			m_pProfiler->Add(m_iSection, m_iChip, CFrameProfiler::clock_t::now() - m_tStart);
+	}
+
+	CProfileScope(const CProfileScope &) = delete;
+	CProfileScope &operator=(const CProfileScope &) = delete;
+
+private:
+	CFrameProfiler *m_pProfiler;
+	profile_section_t m_iSection;
+	sound_chip_t m_iChip;
+	CFrameProfiler::clock_t::time_point m_tStart;
+};
@@ -0,0 +1,442 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "HeadlessRenderer.h"
+#include "FamiTrackerModule.h"
+#include "APU/APU.h"
+#include "APU/Mixer.h"
+#include "APU/RegisterTrace.h"
+#include "APU/VGMWriter.h"
+#include "SoundChipSet.h"
+#include "SoundDriver.h"
+#include "TempoCounter.h"
+#include "PlayerCursor.h"
+#include "ChannelOrder.h"
+#include "SongData.h"
+#include "WaveRenderer.h"
+#include "WaveStream.h"
+#include "SimpleFile.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+#include "StateArchive.h"
+#include "AudioDriver.h"
+#include "AudioSink.h"
+#include "FrameProfiler.h"
+#include "TraceRecorder.h"
+
+array_view<std::uint8_t> ConvertTo8Bit(array_view<int16_t> Samples, std::vector<std::uint8_t> &Buffer) {
+	Buffer.resize(Samples.size());
+	auto it = Buffer.begin();
+	for (int16_t Sample : Samples)
+		*it++ = static_cast<std::uint8_t>((Sample >> 8) ^ 0x80);
+	return {Buffer.data(), Buffer.size()};
+}
+
+CHeadlessRenderer::CHeadlessRenderer(const CFamiTrackerModule &modfile, const stRenderSettings &settings) :
+	modfile_(modfile),
+	settings_(settings),
+	apu_(std::make_unique<CAPU>(this)),
+	driver_(std::make_unique<CSoundDriver>(this)),
+	tempo_(std::make_shared<CTempoCounter>(modfile))
+{
+	driver_->SetupTracks();
+	driver_->AssignModule(modfile_);
+	driver_->LoadAPU(*apu_);
+	driver_->SetTempoCounter(tempo_);
+	driver_->ConfigureDocument();
+
+	// the trace starts before the APU is set up, so that it can be replayed on a new APU
+	if (settings_.RegisterTrace) {
+		trace_ = std::make_unique<CRegisterTrace>();
+		apu_->AddListener(*trace_);
+	}
+	if (settings_.Profile) {
+		profiler_ = std::make_unique<CFrameProfiler>();
+		apu_->SetProfiler(profiler_.get());
+		driver_->SetProfiler(profiler_.get());
+	}
+	SetupSound();
+}
+
+CHeadlessRenderer::~CHeadlessRenderer() {
+}
+
+void CHeadlessRenderer::SetupSound() {
+	machine_t Machine = modfile_.GetMachine();
+	int BaseFreq = (Machine == machine_t::NTSC) ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
+	int Rate = modfile_.GetFrameRate();
+	update_cycles_ = BaseFreq / Rate;
+
+	apu_->SetupSound(settings_.SampleRate, settings_.Channels, Machine, settings_.FloatOutput);
+	apu_->ChangeMachineRate(Machine, Rate);
+	apu_->SetExternalSound(modfile_.GetSoundChipSet());
+	apu_->SetupMixer(settings_.BassFilter, settings_.TrebleFilter, settings_.TrebleDamping, settings_.MixVolume);
+	apu_->SetNamcoMixing(settings_.LinearNamcoMixing);
+	apu_->SetSynthQuality(settings_.SynthQuality);
+	for (const auto &[Chip, Level] : settings_.ChipLevels)
+		apu_->SetChipLevel(Chip, Level);
+	SetupPanning();
+
+	ResetAPU();
+}
+
+// names that do not belong to the module are ignored, so that one set of
+// settings can be used for a whole batch
+void CHeadlessRenderer::SetupPanning() {
+	modfile_.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+		auto name = FTEnv.GetSoundChipService()->GetChannelShortName(ch);
+		for (const auto &[Name, Pan] : settings_.ChannelPans)
+			if (name == Name)
+				apu_->SetChannelPan(ch, Pan / 100.f);
+	});
+}
+
+bool CHeadlessRenderer::RenderToFile(const fs::path &fname, std::shared_ptr<CWaveRenderer> pRender) {
+	if (!pRender)
+		return false;
+
+	auto pFile = std::make_shared<CSimpleFile>(fname, std::ios::out | std::ios::binary);
+	if (!*pFile)
+		return false;
+
+	pRender->SetOutputStream(std::make_unique<COutputWaveStream>(pFile, GetWaveFormat(settings_.Channels)));
+
+	if (settings_.ChannelStems && !OpenStems(fname))
+		return false;
+	if (settings_.VGMOutput && !OpenVGM(fname))
+		return false;
+	Render(*pRender);
+	pRender->CloseOutputStream();
+	CloseStems();
+	CloseVGM();
+
+	if (trace_) {
+		CSimpleFile traceFile {fs::path {fname}.replace_extension(".trace"), std::ios::out | std::ios::binary};
+		if (!traceFile)
+			return false;
+		trace_->Write(traceFile);
+	}
+
+	return true;
+}
+
+bool CHeadlessRenderer::RenderToSink(std::unique_ptr<CAudioSink> pSink, std::shared_ptr<CWaveRenderer> pRender) {
+	if (!pRender || !pSink || pSink->GetBlockSize() <= 0)
+		return false;
+
+	audio_ = std::make_unique<CAudioDriver>(*this, std::move(pSink), settings_.SampleSize);
+	Render(*pRender);
+	audio_->DrainBlocks();
+	audio_->CloseAudioDevice();
+	// the sink may have stopped early, only count what it accepted
+	samples_ = audio_->GetWrittenBytes() / (settings_.SampleSize / 8) / settings_.Channels;
+	audio_.reset();
+
+	return true;
+}
+
+// every stem goes through the same mixer and filters as the main output, in the
+// same pass; nonlinear 2A03 mixing is evaluated as if the other channels were muted
+bool CHeadlessRenderer::OpenStems(const fs::path &fname) {
+	std::vector<stChannelID> channels;
+	bool ok = true;
+
+	modfile_.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+		if (!ok)
+			return;
+		fs::path stemName = fname.parent_path() / (fname.stem().string() + '_' +
+			std::string {FTEnv.GetSoundChipService()->GetChannelShortName(ch)} + ".wav");
+		auto pFile = std::make_shared<CSimpleFile>(stemName, std::ios::out | std::ios::binary);
+		if (!*pFile) {
+			ok = false;
+			return;
+		}
+		stems_.push_back({ch, std::make_unique<COutputWaveStream>(pFile, GetWaveFormat(1u))});
+		channels.push_back(ch);
+	});
+
+	if (!ok) {
+		CloseStems();
+		return false;
+	}
+	apu_->SetStemChannels(channels);
+	return true;
+}
+
+// the VGM stream starts from the APU's current state, which Render resets first
+bool CHeadlessRenderer::OpenVGM(const fs::path &fname) {
+	auto pFile = std::make_shared<CSimpleFile>(fs::path {fname}.replace_extension(".vgm"), std::ios::out | std::ios::binary);
+	if (!*pFile)
+		return false;
+	vgm_ = std::make_unique<CVGMWriter>(std::move(pFile));
+	apu_->AddListener(*vgm_);
+	return true;
+}
+
+void CHeadlessRenderer::CloseVGM() {
+	if (vgm_) {
+		apu_->RemoveListener(*vgm_);
+		vgm_->Close();
+	}
+}
+
+CWaveFileFormat CHeadlessRenderer::GetWaveFormat(unsigned Channels) const {
+	if (settings_.FloatOutput)
+		return {
+			CWaveFileFormat::format_code::ieee_float,
+			static_cast<std::uint16_t>(Channels),
+			static_cast<std::uint32_t>(settings_.SampleRate),
+			32u,
+		};
+	return {
+		CWaveFileFormat::format_code::pcm,
+		static_cast<std::uint16_t>(Channels),
+		static_cast<std::uint32_t>(settings_.SampleRate),
+		static_cast<std::uint16_t>(settings_.SampleSize),
+	};
+}
+
+void CHeadlessRenderer::CloseStems() {
+	stems_.clear();
+	apu_->SetStemChannels({ });
+}
+
+void CHeadlessRenderer::Render(CWaveRenderer &renderer) {
+	BeginRender(renderer);
+	while (RenderFrame())
+		;
+	EndRender();
+}
+
+void CHeadlessRenderer::BeginRender(CWaveRenderer &renderer) {
+	renderer_ = &renderer;
+	frames_ = 0u;
+	samples_ = 0u;
+
+	MakeSilent();		// channel states are undefined until the first reset
+	renderer.Start();
+	for (auto &stem : stems_)
+		stem.pStream->WriteWAVHeader();
+}
+
+// same order of events as CSoundGen::IdleLoop
+bool CHeadlessRenderer::RenderFrame() {
+	CTraceScope trace {"Frame", "render"};
+	trace.SetArg(0, "frame", frames_);
+	++frames_;
+	if (profiler_)
+		profiler_->BeginFrame();
+	driver_->Tick();
+
+	if (renderer_->ShouldStopRender())
+		return false;
+	if (renderer_->ShouldStartPlayer())
+		BeginPlayer(renderer_->GetRenderTrack());
+
+	UpdateAPU();
+	if (profiler_)
+		profiler_->EndFrame();
+	if (audio_) {
+		CTraceScope wait {"Wait for audio", "audio"};
+		if (!audio_->PlayBlocks())		// the sink stopped accepting blocks
+			return false;
+	}
+
+	if (driver_->ShouldHalt())
+		HaltPlayer();
+	return true;
+}
+
+void CHeadlessRenderer::EndRender() {
+	renderer_ = nullptr;
+	HaltPlayer();
+	ResetAPU();
+}
+
+// restoring a snapshot onto another renderer for the same module and settings
+// continues the output exactly where the snapshot was taken; the APU listeners
+// (register trace, VGM output) only see writes made after the restore
+void CHeadlessRenderer::SerializeState(CStateArchive &ar) {
+	SerializePlayerState(ar);
+	ar(frames_, samples_);
+	if (renderer_)
+		ar(*renderer_);
+}
+
+void CHeadlessRenderer::SerializePlayerState(CStateArchive &ar) {
+	ar(*apu_, *driver_);
+}
+
+std::optional<std::pair<unsigned, unsigned>> CHeadlessRenderer::GetPendingRow() const {
+	if (driver_->IsPlaying() && tempo_->CanStepRow())
+		if (const auto *pCursor = driver_->GetPlayerCursor())
+			return std::pair {pCursor->GetCurrentFrame(), pCursor->GetCurrentRow()};
+	return std::nullopt;
+}
+
+const stRenderSettings &CHeadlessRenderer::GetRenderSettings() const {
+	return settings_;
+}
+
+const CRegisterTrace *CHeadlessRenderer::GetRegisterTrace() const {
+	return trace_.get();
+}
+
+const CVGMWriter *CHeadlessRenderer::GetVGMWriter() const {
+	return vgm_.get();
+}
+
+const CFrameProfiler *CHeadlessRenderer::GetProfiler() const {
+	return profiler_.get();
+}
+
+unsigned CHeadlessRenderer::GetRenderedFrames() const {
+	return frames_;
+}
+
+std::size_t CHeadlessRenderer::GetRenderedSamples() const {
+	return samples_;
+}
+
+void CHeadlessRenderer::ResetAPU() {
+	apu_->Reset();
+
+	apu_->Write(0x4015, 0x0F);
+	apu_->Write(0x4017, 0x00);
+	apu_->Write(0x4023, 0x02);		// FDS enable
+	apu_->Write(0x5015, 0x03);		// MMC5
+}
+
+void CHeadlessRenderer::BeginPlayer(unsigned track) {
+	const CSongData &song = *modfile_.GetSong(track);
+	driver_->StartPlayer(std::make_unique<CPlayerCursor>(song, track));
+	tempo_->LoadTempo(song);
+
+	ResetAPU();
+	MakeSilent();
+}
+
+void CHeadlessRenderer::HaltPlayer() {
+	MakeSilent();
+	driver_->StopPlayer();
+}
+
+void CHeadlessRenderer::MakeSilent() {
+	apu_->Reset();
+	driver_->ResetTracks();
+}
+
+void CHeadlessRenderer::UpdateAPU() {
+	int cycles = update_cycles_;
+	sound_chip_t LastChip = sound_chip_t::none;
+
+	// channel register writes are spread across the frame like in CSoundGen::UpdateAPU
+	driver_->ForeachTrack([&] (CChannelHandler &, CTrackerChannel &, stChannelID ID) {
+		if (modfile_.GetChannelOrder().HasChannel(ID)) {
+			int Delay = (ID.Chip == LastChip) ? 150 : 250;
+			if (Delay < cycles) {
+				cycles -= Delay;
+				apu_->AddTime(Delay);
+			}
+			LastChip = ID.Chip;
+		}
+		apu_->Process();
+	});
+
+	apu_->AddTime(cycles);
+	apu_->Process();
+	apu_->EndFrame();
+}
+
+void CHeadlessRenderer::FlushBuffer(array_view<int16_t> Buffer) {
+	FlushBufferImpl(Buffer);
+}
+
+void CHeadlessRenderer::FlushBuffer(array_view<float> Buffer) {
+	FlushBufferImpl(Buffer);
+}
+
+template <typename T>
+void CHeadlessRenderer::FlushBufferImpl(array_view<T> Buffer) {
+	const bool started = renderer_ && renderer_->Started();
+
+	// stem buffers are drained every frame even when nothing is written
+	auto &stemBuf = [&] () -> std::vector<T> & {
+		if constexpr (std::is_same_v<T, float>)
+			return stemBufFloat_;
+		else
+			return stemBuf_;
+	}();
+	stemBuf.resize(Buffer.size());
+	for (auto &stem : stems_) {
+		int count = apu_->ReadStemBuffer(stem.Channel, stemBuf.data(), static_cast<int>(stemBuf.size()));
+		if (started)
+			stem.pStream->WriteSamples(array_view<T>(stemBuf.data(), count));
+	}
+
+	if (!started)
+		return;
+
+	samples_ += Buffer.size() / settings_.Channels;		// counted per channel
+	if (audio_)
+		return audio_->FlushBuffer(Buffer);
+	if constexpr (std::is_integral_v<T>)
+		if (settings_.SampleSize == 8)
+			return renderer_->FlushBuffer(ConvertTo8Bit(Buffer, conv_));
+	renderer_->FlushBuffer(Buffer);
+}
+
+bool CHeadlessRenderer::PlayBuffer() {
+	return !audio_ || audio_->DoPlayBuffer();
+}
+
+CInstrumentManager *CHeadlessRenderer::GetInstrumentManager() const {
+	return modfile_.GetInstrumentManager();
+}
+
+void CHeadlessRenderer::OnTick() {
+	if (renderer_)
+		renderer_->Tick();
+}
+
+void CHeadlessRenderer::OnStepRow() {
+	if (renderer_)
+		renderer_->StepRow();
+}
+
+void CHeadlessRenderer::OnPlayNote(stChannelID chan, const stChanNote &note) {
+}
+
+void CHeadlessRenderer::OnUpdateRow(int frame, int row) {
+}
+
+bool CHeadlessRenderer::IsChannelMuted(stChannelID chan) const {
+	return false;
+}
+
+bool CHeadlessRenderer::ShouldStopPlayer() const {
+	return renderer_ && renderer_->ShouldStopPlayer();
+}
+
+int CHeadlessRenderer::GetArpNote(stChannelID chan) const {
+	return -1;
+}
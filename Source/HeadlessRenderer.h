@@ -0,0 +1,162 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <utility>
+#include <optional>
+#include "Common.h"
+#include "SoundGenBase.h"
+#include "APU/Types.h"
+#include "ft0cc/fs.h"
+
+class CFamiTrackerModule;
+class CAPU;
+class CRegisterTrace;
+class CVGMWriter;
+class CSoundDriver;
+class CTempoCounter;
+class CWaveRenderer;
+class CAudioSink;
+class CAudioDriver;
+class COutputWaveStream;
+class CStateArchive;
+class CFrameProfiler;
+struct CWaveFileFormat;
+enum chip_level_t : unsigned char;
+
+// // // sound settings used by the headless renderer, defaults match the tracker's
+struct stRenderSettings {
+	unsigned SampleRate = 44100u;
+	unsigned SampleSize = 16u;
+	bool FloatOutput = false;		// 32-bit float samples without clipping, SampleSize is ignored
+	int BassFilter = 30;
+	int TrebleFilter = 12000;
+	int TrebleDamping = 24;
+	int MixVolume = 100;
+	bool LinearNamcoMixing = false;
+	synth_quality_t SynthQuality = synth_quality_t::Good;
+	bool ChannelStems = false;		// also write <name>_<channel>.wav for every channel
+	unsigned Channels = 1u;			// 2 for interleaved stereo, stems are always mono
+	std::vector<std::pair<std::string, int>> ChannelPans;		// channel short name, -100 (left) to 100 (right)
+	std::vector<std::pair<chip_level_t, float>> ChipLevels;		// in dB, chips not listed stay at 0
+	bool RegisterTrace = false;		// also write <name>.trace, see CRegisterTrace
+	bool VGMOutput = false;			// also write <name>.vgm, see CVGMWriter
+	bool Profile = false;			// time every frame, see CFrameProfiler
+};
+
+// // // the APU's 16-bit output as the unsigned 8-bit samples of CAudioDriver::FillBuffer,
+// converted into Buffer
+array_view<std::uint8_t> ConvertTo8Bit(array_view<int16_t> Samples, std::vector<std::uint8_t> &Buffer);
+
+// // // drives the sound driver and the APU directly without an audio device or
+// message loop, each frame is emulated as soon as the previous one is written
+class CHeadlessRenderer : public CSoundGenBase, public IAudioCallback {
+public:
+	explicit CHeadlessRenderer(const CFamiTrackerModule &modfile, const stRenderSettings &settings = { });
+	~CHeadlessRenderer();
+
+	bool RenderToFile(const fs::path &fname, std::shared_ptr<CWaveRenderer> pRender);
+	// // // plays through CAudioDriver into a sink the way CSoundGen plays into DirectSound,
+	// 8- or 16-bit samples only; float output is clipped to 16 bits like in the tracker
+	bool RenderToSink(std::unique_ptr<CAudioSink> pSink, std::shared_ptr<CWaveRenderer> pRender);
+	void Render(CWaveRenderer &renderer);
+
+	// // // Render split into steps, snapshots may be taken or restored between frames
+	void BeginRender(CWaveRenderer &renderer);
+	bool RenderFrame();		// false once the renderer has stopped
+	void EndRender();
+	void SerializeState(CStateArchive &ar);
+	void SerializePlayerState(CStateArchive &ar);		// APU and sound driver only, see CSoundGen
+
+	// frame / row that the next frame starts playing, if it starts a row
+	std::optional<std::pair<unsigned, unsigned>> GetPendingRow() const;
+
+	const stRenderSettings &GetRenderSettings() const;
+	const CRegisterTrace *GetRegisterTrace() const;
+	const CVGMWriter *GetVGMWriter() const;
+	const CFrameProfiler *GetProfiler() const;
+	unsigned GetRenderedFrames() const;
+	std::size_t GetRenderedSamples() const;
+
+private:
+	void SetupSound();
+	void SetupPanning();
+	bool OpenStems(const fs::path &fname);
+	void CloseStems();
+	bool OpenVGM(const fs::path &fname);
+	void CloseVGM();
+	void ResetAPU();
+	void BeginPlayer(unsigned track);
+	void HaltPlayer();
+	void MakeSilent();
+	void UpdateAPU();
+	CWaveFileFormat GetWaveFormat(unsigned Channels) const;
+	template <typename T>
+	void FlushBufferImpl(array_view<T> Buffer);
+
+	// IAudioCallback impl
+	void FlushBuffer(array_view<int16_t> Buffer) override;
+	void FlushBuffer(array_view<float> Buffer) override;
+	bool PlayBuffer() override;
+
+	// CSoundGenBase impl
+	CInstrumentManager *GetInstrumentManager() const override;
+	void OnTick() override;
+	void OnStepRow() override;
+	void OnPlayNote(stChannelID chan, const stChanNote &note) override;
+	void OnUpdateRow(int frame, int row) override;
+	bool IsChannelMuted(stChannelID chan) const override;
+	bool ShouldStopPlayer() const override;
+	int GetArpNote(stChannelID chan) const override;
+
+private:
+	const CFamiTrackerModule &modfile_;
+	stRenderSettings settings_;
+
+	std::unique_ptr<CAPU> apu_;
+	std::unique_ptr<CRegisterTrace> trace_;
+	std::unique_ptr<CVGMWriter> vgm_;
+	std::unique_ptr<CFrameProfiler> profiler_;
+	std::unique_ptr<CAudioDriver> audio_;
+	std::unique_ptr<CSoundDriver> driver_;
+	std::shared_ptr<CTempoCounter> tempo_;
+
+	CWaveRenderer *renderer_ = nullptr;
+	int update_cycles_ = 0;
+	unsigned frames_ = 0u;
+	std::size_t samples_ = 0u;
+	std::vector<std::uint8_t> conv_;
+
+	struct stStemOutput {
+		stChannelID Channel;
+		std::unique_ptr<COutputWaveStream> pStream;
+	};
+	std::vector<stStemOutput> stems_;
+	std::vector<int16_t> stemBuf_;
+	std::vector<float> stemBufFloat_;
+};
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <memory>
+#include "StateArchive.h"		// // //
 
 class CChannelHandlerInterface;
 class CInstrument;
@@ -71,6 +72,12 @@ public:
 		\details The method does not specify whether a note can be released for multiple times until
 		another new note is triggered. */
 	virtual void ReleaseInstrument() = 0;
+	/*!	\brief Stores or restores the playback state of the instrument handler.
+		\details Overrides in subclasses must call the superclass method first.
+		\param ar The state archive. */
+	virtual void SerializeState(CStateArchive &ar) {		// // //
+		ar(m_pInstrument, m_iVolume, m_iNoteOffset, m_iPitchOffset);
+	}
 
 protected:
 	/*!	\brief An interface to the underlying channel handler.
@@ -54,6 +54,12 @@ void CInstHandlerVRC7::UpdateInstrument()
 	m_bUpdate = false;
 }
 
+void CInstHandlerVRC7::SerializeState(CStateArchive &ar)		// // //
+{
+	CInstHandler::SerializeState(ar);
+	ar(m_bUpdate);
+}
+
 void CInstHandlerVRC7::UpdateRegs()
 {
 	m_bUpdate = true;
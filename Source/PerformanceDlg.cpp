@@ -25,6 +25,13 @@
 #include "APU/Types.h"
 #include "SoundGen.h"
 #include "AudioDriver.h"		// // //
+#include "FrameProfiler.h"		// // //
+#include "FamiTrackerEnv.h"		// // //
+#include "SoundChipService.h"		// // //
+#include "str_conv/str_conv.hpp"		// // //
+#include "TraceRecorder.h"		// // //
+#include "FileDialogs.h"		// // //
+#include "SimpleFile.h"		// // //
 
 // CPerformanceDlg dialog
 
@@ -47,6 +54,7 @@ void CPerformanceDlg::DoDataExchange(CDataExchange* pDX)
 BEGIN_MESSAGE_MAP(CPerformanceDlg, CDialog)
 	ON_WM_TIMER()
 	ON_BN_CLICKED(IDOK, OnBnClickedOk)
+	ON_BN_CLICKED(IDC_TRACE, OnBnClickedTrace)		// // //
 END_MESSAGE_MAP()
 
 
@@ -59,6 +67,20 @@ BOOL CPerformanceDlg::OnInitDialog()
 	theApp.GetCPUUsage();
 	theApp.GetSoundGenerator()->GetFrameRate();
 
+	// // // frame timings are only taken while the dialog is open
+	m_cProfileList.SubclassDlgItem(IDC_PROFILE, this);
+	m_cProfileList.SetExtendedStyle(LVS_EX_GRIDLINES | LVS_EX_FULLROWSELECT);
+	CRect r;
+	m_cProfileList.GetClientRect(&r);
+	const int w = r.Width() - ::GetSystemMetrics(SM_CXHSCROLL);
+	m_cProfileList.InsertColumn(0, L"Section", LVCFMT_LEFT, static_cast<int>(.4 * w));
+	m_cProfileList.InsertColumn(1, L"Median", LVCFMT_RIGHT, static_cast<int>(.2 * w));
+	m_cProfileList.InsertColumn(2, L"99%", LVCFMT_RIGHT, static_cast<int>(.2 * w));
+	m_cProfileList.InsertColumn(3, L"Max", LVCFMT_RIGHT, static_cast<int>(.2 * w));
+	theApp.GetSoundGenerator()->SetProfiling(true);
+	if (FTEnv.GetTraceRecorder()->IsRecording())
+		SetDlgItemTextW(IDC_TRACE, L"Stop trace");
+
 	SetTimer(1, 1000, NULL);
 
 	return TRUE;  // return TRUE unless you set the focus to a control
@@ -78,16 +100,74 @@ void CPerformanceDlg::OnTimer(UINT_PTR nIDEvent) {		// // //
 	pBar->SetRange(0, 100);
 	pBar->SetPos(Usage / 100);
 
+	UpdateProfile();		// // //
+
 	CDialog::OnTimer(nIDEvent);
 }
 
+void CPerformanceDlg::UpdateProfile()		// // //
+{
+	const CFrameProfiler *pProfiler = theApp.GetSoundGenerator()->GetFrameProfiler();
+	const CSoundChipService *pService = FTEnv.GetSoundChipService();
+
+	int Row = 0;
+	auto AddRow = [&] (const CStringW &Name, const stProfileStats &Stats) {
+		if (Row >= m_cProfileList.GetItemCount())
+			m_cProfileList.InsertItem(Row, L"");
+		m_cProfileList.SetItemText(Row, 0, Name);
+		m_cProfileList.SetItemText(Row, 1, Stats.Frames ? FormattedW(L"%.1f", Stats.P50) : CStringW(L"-"));
+		m_cProfileList.SetItemText(Row, 2, Stats.Frames ? FormattedW(L"%.1f", Stats.P99) : CStringW(L"-"));
+		m_cProfileList.SetItemText(Row, 3, Stats.Frames ? FormattedW(L"%.1f", Stats.Max) : CStringW(L"-"));
+		++Row;
+	};
+
+	m_cProfileList.SetRedraw(FALSE);
+	for (auto Section : enum_values<profile_section_t>()) {
+		CStringW Name = conv::to_wide(CFrameProfiler::GetSectionName(Section)).data();
+		if (!CFrameProfiler::IsPerChip(Section))
+			AddRow(Name, pProfiler->GetStats(Section));
+		else
+			pService->ForeachType([&] (sound_chip_t Chip) {
+				if (auto Stats = pProfiler->GetStats(Section, Chip); Stats.Frames)
+					AddRow(Name + L" (" + conv::to_wide(pService->GetChipShortName(Chip)).data() + L")", Stats);
+			});
+	}
+	while (m_cProfileList.GetItemCount() > Row)
+		m_cProfileList.DeleteItem(Row);
+	m_cProfileList.SetRedraw(TRUE);
+}
+
 void CPerformanceDlg::OnBnClickedOk()
 {
 	DestroyWindow();
 }
 
+void CPerformanceDlg::OnBnClickedTrace()		// // //
+{
+	// the recording goes on if the dialog is closed, until the button is clicked again
+	CTraceRecorder *pRecorder = FTEnv.GetTraceRecorder();
+	if (!pRecorder->IsRecording()) {
+		pRecorder->Start();
+		SetDlgItemTextW(IDC_TRACE, L"Stop trace");
+		return;
+	}
+
+	pRecorder->Stop();
+	SetDlgItemTextW(IDC_TRACE, L"Record trace");
+	if (auto path = GetSavePath(L"trace.json", L"", IDS_FILTER_JSON, L"*.json")) {
+		CSimpleFile file {*path, std::ios::out | std::ios::binary};
+		if (!file) {
+			AfxMessageBox(FormattedW(L"Error: Could not open output file: %s\n",
+				conv::to_wide(file.GetErrorMessage()).data()), MB_ICONERROR);
+			return;
+		}
+		pRecorder->Write(file);
+	}
+}
+
 BOOL CPerformanceDlg::DestroyWindow()
 {
 	KillTimer(1);
+	theApp.GetSoundGenerator()->SetProfiling(false);		// // //
 	return CDialog::DestroyWindow();
 }
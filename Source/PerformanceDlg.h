@@ -42,10 +42,15 @@ public:
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
 
+	void UpdateProfile();		// // //
+
+	CListCtrl m_cProfileList;		// // //
+
 	DECLARE_MESSAGE_MAP()
 public:
 	virtual BOOL OnInitDialog();
 	afx_msg void OnTimer(UINT_PTR nIDEvent);		// // //
 	afx_msg void OnBnClickedOk();
+	afx_msg void OnBnClickedTrace();		// // //
 	virtual BOOL DestroyWindow();
 };
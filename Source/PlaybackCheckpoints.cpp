@@ -0,0 +1,133 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "PlaybackCheckpoints.h"
+#include "FamiTrackerModule.h"
+#include "WaveRenderer.h"
+#include "WaveRendererFactory.h"
+#include <iterator>
+
+CPlaybackCheckpoints::CPlaybackCheckpoints(const CFamiTrackerModule &modfile, unsigned track, const stRenderSettings &settings,
+	unsigned interval, std::size_t memoryLimit) :
+	modfile_(modfile),
+	track_(track),
+	settings_(settings),
+	interval_(interval ? interval : DEFAULT_INTERVAL),
+	memoryLimit_(memoryLimit)
+{
+	settings_.ChannelStems = false;
+	settings_.RegisterTrace = false;
+	settings_.VGMOutput = false;
+
+	pass_ = std::make_unique<CHeadlessRenderer>(modfile_, settings_);
+	if (passRenderer_ = MakeRenderer(); passRenderer_)
+		pass_->BeginRender(*passRenderer_);
+	else
+		finished_ = true;
+}
+
+CPlaybackCheckpoints::~CPlaybackCheckpoints() {
+}
+
+unsigned CPlaybackCheckpoints::GetTrack() const {
+	return track_;
+}
+
+bool CPlaybackCheckpoints::IsFinished() const {
+	return finished_;
+}
+
+std::size_t CPlaybackCheckpoints::GetCheckpointCount() const {
+	return checkpoints_.size();
+}
+
+std::size_t CPlaybackCheckpoints::GetMemoryUsage() const {
+	return memoryUsage_;
+}
+
+bool CPlaybackCheckpoints::Advance(unsigned frames) {
+	while (!finished_ && frames--) {
+		if (auto Pos = pass_->GetPendingRow())
+			rows_.try_emplace(*Pos, pass_->GetRenderedFrames());
+		if (!pass_->RenderFrame()) {
+			pass_->EndRender();
+			finished_ = true;
+		}
+		else if (pass_->GetRenderedFrames() % interval_ == 0)
+			AddCheckpoint();
+	}
+	return !finished_;
+}
+
+bool CPlaybackCheckpoints::Seek(unsigned frame, unsigned row, CStateArchive &ar, unsigned maxFrames) {
+	auto it = rows_.find({frame, row});
+	if (it == rows_.end())
+		return false;
+	const unsigned Target = it->second;
+
+	auto cp = checkpoints_.upper_bound(Target);
+	unsigned Start = cp == checkpoints_.begin() ? 0u : std::prev(cp)->first;
+	if (Target - Start > maxFrames)
+		return false;
+
+	if (cp == checkpoints_.begin() || !seeker_) {
+		seekRenderer_ = MakeRenderer();
+		seeker_ = std::make_unique<CHeadlessRenderer>(modfile_, settings_);
+	}
+	seeker_->BeginRender(*seekRenderer_);
+	if (cp != checkpoints_.begin()) {
+		--cp;
+		lru_.splice(lru_.begin(), lru_, cp->second.LRUPos);
+		cp->second.State.BeginLoad();
+		seeker_->SerializeState(cp->second.State);
+	}
+
+	while (seeker_->GetRenderedFrames() < Target && seeker_->RenderFrame())
+		;
+	ar.BeginSave();
+	seeker_->SerializePlayerState(ar);
+	return true;
+}
+
+// one pass through the loop reaches every row that the track plays
+std::unique_ptr<CWaveRenderer> CPlaybackCheckpoints::MakeRenderer() const {
+	auto pRender = CWaveRendererFactory::Make(modfile_, track_, render_type_t::Loops, 1u);
+	if (pRender)
+		pRender->SetRenderTrack(track_);
+	return pRender;
+}
+
+void CPlaybackCheckpoints::AddCheckpoint() {
+	unsigned Frame = pass_->GetRenderedFrames();
+	auto &cp = checkpoints_[Frame];
+	cp.State.BeginSave();
+	pass_->SerializeState(cp.State);
+	cp.LRUPos = lru_.insert(lru_.begin(), Frame);
+	memoryUsage_ += cp.State.GetSize();
+
+	while (memoryUsage_ > memoryLimit_ && lru_.size() > 1u) {
+		auto old = checkpoints_.find(lru_.back());
+		memoryUsage_ -= old->second.State.GetSize();
+		checkpoints_.erase(old);
+		lru_.pop_back();
+	}
+}
@@ -0,0 +1,92 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <map>
+#include <list>
+#include <utility>
+#include "HeadlessRenderer.h"
+#include "StateArchive.h"
+
+class CFamiTrackerModule;
+class CWaveRenderer;
+
+// // // index of playback snapshots for one track
+//
+// A silent pass plays the track once through its loop and keeps a snapshot every
+// few frames. Seeking restores the nearest earlier snapshot onto a second silent
+// player and plays forward to the requested row, so the result is the state the
+// track has there when it is played from the start. Once the memory limit is
+// reached the least recently used snapshots are dropped; seeking past a dropped
+// snapshot only plays forward for longer. The module must not change while the
+// index is in use.
+class CPlaybackCheckpoints {
+public:
+	static constexpr unsigned DEFAULT_INTERVAL = 150u;				// frames between snapshots
+	static constexpr std::size_t DEFAULT_MEMORY_LIMIT = 64u << 20;	// bytes
+
+	CPlaybackCheckpoints(const CFamiTrackerModule &modfile, unsigned track, const stRenderSettings &settings,
+		unsigned interval = DEFAULT_INTERVAL, std::size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+	~CPlaybackCheckpoints();
+
+	unsigned GetTrack() const;
+	bool IsFinished() const;
+	std::size_t GetCheckpointCount() const;
+	std::size_t GetMemoryUsage() const;
+
+	// runs the silent pass for up to the given number of frames, false once it has finished
+	bool Advance(unsigned frames);
+	// stores the player state at the start of the row as CHeadlessRenderer::SerializePlayerState
+	// does, false if the pass has not reached the row yet or if the nearest earlier snapshot
+	// is more than maxFrames before it
+	bool Seek(unsigned frame, unsigned row, CStateArchive &ar, unsigned maxFrames = static_cast<unsigned>(-1));
+
+private:
+	struct stCheckpoint {
+		CStateArchive State;
+		std::list<unsigned>::iterator LRUPos;
+	};
+
+	std::unique_ptr<CWaveRenderer> MakeRenderer() const;
+	void AddCheckpoint();
+
+	const CFamiTrackerModule &modfile_;
+	unsigned track_;
+	stRenderSettings settings_;
+	unsigned interval_;
+	std::size_t memoryLimit_;
+
+	std::unique_ptr<CWaveRenderer> passRenderer_;
+	std::unique_ptr<CHeadlessRenderer> pass_;
+	std::unique_ptr<CWaveRenderer> seekRenderer_;
+	std::unique_ptr<CHeadlessRenderer> seeker_;
+	bool finished_ = false;
+
+	std::map<std::pair<unsigned, unsigned>, unsigned> rows_;	// frame / row -> frames played before it first starts
+	std::map<unsigned, stCheckpoint> checkpoints_;				// by frames played
+	std::list<unsigned> lru_;									// most recently used first
+	std::size_t memoryUsage_ = 0u;
+};
@@ -21,6 +21,7 @@
 */
 
 #include "RegisterState.h"
+#include "StateArchive.h"		// // //
 
 CRegisterLogger::CRegisterLogger() :
 	m_mRegister(),
@@ -85,6 +86,13 @@ void CRegisterLogger::Step()
 		r.second.Step();
 }
 
+void CRegisterLogger::SerializeState(CStateArchive &ar)		// // //
+{
+	for (auto &r : m_mRegister)
+		ar(r.second);
+	ar(m_iPort, m_bAutoIncrement);
+}
+
 
 
 CRegisterLoggerBlock::CRegisterLoggerBlock(CRegisterLogger &Logger) :
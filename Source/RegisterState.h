@@ -24,6 +24,9 @@
 #pragma once
 
 #include <unordered_map>
+#include <cstdint>
+
+class CStateArchive;		// // //
 
 /*!
 	\brief A class which manages writes to a single APU register.
@@ -113,6 +116,12 @@ public:
 	/*!	\brief Steps one tick and updates the time information of all registers. */
 	void Step();
 
+	/*!	\brief Stores or restores the register contents and the address port.
+		\details The register ranges are not stored, since they are fixed when the sound chip is
+		created; the archive must be restored onto a logger with the same ranges.
+		\param ar The state archive. */
+	void SerializeState(CStateArchive &ar);		// // //
+
 protected:
 	std::unordered_map<unsigned, CRegisterState> m_mRegister;
 	std::unordered_map<unsigned, unsigned> m_mWarpValues;
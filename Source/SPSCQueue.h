@@ -0,0 +1,112 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// // // bounded single-producer/single-consumer queue
+//
+// One thread pushes and one thread pops; neither takes a lock. Each side
+// owns one index and only reads the other's, so the only synchronization is
+// the release store that publishes an index and the acquire load that sees
+// it. Slots are allocated up front and reused, so an element can be written
+// in place with BeginPush / EndPush and read in place with Front / Pop.
+// Clear may only be called while neither side is running.
+
+template <typename T>
+class CSPSCQueue {
+public:
+	explicit CSPSCQueue(std::size_t Capacity, const T &Init = T { }) :
+		m_Slots(Capacity + 1, Init)
+	{
+	}
+
+	CSPSCQueue(const CSPSCQueue &) = delete;
+	CSPSCQueue &operator=(const CSPSCQueue &) = delete;
+
+	// producer side
+
+	// returns the slot to fill, or nullptr if the queue is full
+	T *BeginPush() {
+		std::size_t Head = m_iHead.load(std::memory_order_relaxed);
+		if (Next(Head) == m_iTail.load(std::memory_order_acquire))
+			return nullptr;
+		return &m_Slots[Head];
+	}
+	// publishes the slot returned by BeginPush
+	void EndPush() {
+		m_iHead.store(Next(m_iHead.load(std::memory_order_relaxed)), std::memory_order_release);
+	}
+	bool TryPush(const T &Value) {
+		T *pSlot = BeginPush();
+		if (!pSlot)
+			return false;
+		*pSlot = Value;
+		EndPush();
+		return true;
+	}
+
+	// consumer side
+
+	// returns the oldest element, or nullptr if the queue is empty
+	T *Front() {
+		std::size_t Tail = m_iTail.load(std::memory_order_relaxed);
+		if (Tail == m_iHead.load(std::memory_order_acquire))
+			return nullptr;
+		return &m_Slots[Tail];
+	}
+	// releases the slot returned by Front
+	void Pop() {
+		m_iTail.store(Next(m_iTail.load(std::memory_order_relaxed)), std::memory_order_release);
+	}
+	bool TryPop(T &Value) {
+		T *pSlot = Front();
+		if (!pSlot)
+			return false;
+		Value = *pSlot;
+		Pop();
+		return true;
+	}
+
+	void Clear() {
+		m_iHead.store(0, std::memory_order_relaxed);
+		m_iTail.store(0, std::memory_order_relaxed);
+	}
+
+	std::size_t GetCapacity() const {
+		return m_Slots.size() - 1;
+	}
+
+private:
+	std::size_t Next(std::size_t Index) const {
+		return Index + 1 == m_Slots.size() ? 0 : Index + 1;
+	}
+
+private:
+	std::vector<T> m_Slots;		// one slot stays empty to tell a full queue from an empty one
+	alignas(64) std::atomic<std::size_t> m_iHead {0};		// written by the producer
+	alignas(64) std::atomic<std::size_t> m_iTail {0};		// written by the consumer
+};
@@ -122,6 +122,17 @@ void CSeqInstHandler::UpdateInstrument()
 	}
 }
 
+void CSeqInstHandler::SerializeState(CStateArchive &ar)		// // //
+{
+	CInstHandler::SerializeState(ar);
+	// every handler holds the same sequence types, so the entries are visited in the same order
+	for (auto &[_, info] : m_SequenceInfo) {
+		(void)_;
+		ar(info.m_pSequence, info.m_iSeqState, info.m_iSeqPointer);
+	}
+	ar(m_iDutyParam);
+}
+
 bool CSeqInstHandler::ProcessSequence(const CSequence &Seq, int Pos)
 {
 	int Value = Seq.GetItem(Pos);
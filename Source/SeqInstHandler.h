@@ -56,6 +56,7 @@ public:
 	void TriggerInstrument() override;
 	void ReleaseInstrument() override;
 	void UpdateInstrument() override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 protected:
 	/*!	\brief Processes the value retrieved from a sequence.
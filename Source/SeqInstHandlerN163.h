@@ -50,6 +50,7 @@ public:
 	/*!	\brief Runs the instrument by one tick and updates the channel state.
 		\details This reimplementation may update the channel's wave buffer. */
 	void UpdateInstrument() override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 	/*!	\brief Requests the instrument handler to overwrite the wave buffer for the next tick. */
 	void RequestWaveUpdate();
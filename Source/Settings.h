@@ -80,6 +80,7 @@ public:
 		bool	bCutVolume;
 		bool	bFDSOldVolume;
 		bool	bRetrieveChanState;
+		bool	bCheckpointSeek;		// // //
 		bool	bOverflowPaste;
 		bool	bShowSkippedRows;
 		bool	bHexKeypad;
@@ -270,6 +270,7 @@ void CSettingsService::SetupSettings() {
 	NewSetting(L"General", L"Cut sub-volume", false, s.General.bCutVolume);
 	NewSetting(L"General", L"Use old FDS volume table", false, s.General.bFDSOldVolume);
 	NewSetting(L"General", L"Retrieve channel state", false, s.General.bRetrieveChanState);
+	NewSetting(L"General", L"Checkpoint playback start", false, s.General.bCheckpointSeek);		// // //
 	NewSetting(L"General", L"Overflow paste mode", false, s.General.bOverflowPaste);
 	NewSetting(L"General", L"Show skipped rows", false, s.General.bShowSkippedRows);
 	NewSetting(L"General", L"Hexadecimal keypad", false, s.General.bHexKeypad);
@@ -193,3 +193,11 @@ void CSimpleFile::Seek(std::size_t pos) {
 std::size_t CSimpleFile::GetPosition() {
 	return m_fFile.tellp();
 }
+
+std::size_t CSimpleFile::GetLength() {		// // //
+	auto pos = m_fFile.tellp();
+	m_fFile.seekp(0, std::ios::end);
+	std::size_t len = m_fFile.tellp();
+	m_fFile.seekp(pos);
+	return len;
+}
@@ -65,6 +65,7 @@ public:
 
 	void		Seek(std::size_t pos);
 	std::size_t GetPosition();
+	std::size_t GetLength();		// // //
 
 private:
 	std::fstream m_fFile;
@@ -34,6 +34,9 @@
 #include "SongState.h"
 #include "ChannelMap.h"
 #include "Assertion.h"
+#include "StateArchive.h"		// // //
+#include "FrameProfiler.h"		// // //
+#include "TraceRecorder.h"		// // //
 
 
 
@@ -79,6 +82,10 @@ void CSoundDriver::LoadAPU(CAPUInterface &apu) {
 	});
 }
 
+void CSoundDriver::SetProfiler(CFrameProfiler *profiler) {		// // //
+	profiler_ = profiler;
+}
+
 void CSoundDriver::ConfigureDocument() {
 	SetupVibrato();
 	SetupPeriodTables();
@@ -147,7 +154,34 @@ void CSoundDriver::SetTempoCounter(std::shared_ptr<CTempoCounter> tempo) {
 		m_pTempoCounter->AssignModule(*modfile_);
 }
 
+void CSoundDriver::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_bPlaying, m_bHaltRequest, m_iJumpToPattern, m_iSkipToRow, m_bDoHalt);
+
+	bool HasCursor = m_pPlayerCursor != nullptr;
+	unsigned Track = HasCursor ? m_pPlayerCursor->GetCurrentSong() : 0u;
+	ar(HasCursor, Track);
+	if (ar.IsLoading()) {
+		if (!HasCursor)
+			m_pPlayerCursor.reset();
+		else if (!m_pPlayerCursor || m_pPlayerCursor->GetCurrentSong() != Track)
+			m_pPlayerCursor = std::make_unique<CPlayerCursor>(*modfile_->GetSong(Track), Track);
+	}
+	if (m_pPlayerCursor)
+		ar(*m_pPlayerCursor);
+	if (m_pTempoCounter)
+		ar(*m_pTempoCounter);
+
+	for (auto &chip : chips_)
+		ar(*chip);
+	ForeachTrack([&] (CChannelHandler &ch, CTrackerChannel &tr, stChannelID id) {
+		if (modfile_->GetChannelOrder().HasChannel(id))
+			ar(ch, tr);
+	});
+}
+
 void CSoundDriver::Tick() {
+	CProfileScope scope {profiler_, profile_section_t::DriverTick};		// // //
+	CTraceScope trace {"Driver tick", "driver"};		// // //
 	if (IsPlaying())
 		PlayerTick();
 	UpdateChannels();
@@ -178,6 +212,9 @@ void CSoundDriver::PlayerTick() {
 	// Fetch next row
 //	while (m_pTempoCounter->CanStepRow()) {
 	if (m_pTempoCounter->CanStepRow()) {
+		CTraceScope trace {"Step row", "driver"};		// // //
+		trace.SetArg(0, "frame", m_pPlayerCursor->GetCurrentFrame());
+		trace.SetArg(1, "row", m_pPlayerCursor->GetCurrentRow());
 		if (m_bDoHalt)
 			m_bHaltRequest = true;
 		else
@@ -236,8 +273,14 @@ void CSoundDriver::UpdateChannels() {
 		Chan.SetPitch(TrackerChan.GetPitch());
 
 		// Channel updates (instruments, effects etc)
-		m_bHaltRequest ? Chan.ResetChannel() : Chan.ProcessChannel();
-		Chan.RefreshChannel();
+		{
+			CProfileScope scope {profiler_, profile_section_t::ProcessChannel, ID.Chip};		// // //
+			m_bHaltRequest ? Chan.ResetChannel() : Chan.ProcessChannel();
+		}
+		{
+			CProfileScope scope {profiler_, profile_section_t::RefreshChannel, ID.Chip};		// // //
+			Chan.RefreshChannel();
+		}
 		Chan.FinishTick();		// // //
 	});
 
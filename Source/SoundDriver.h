@@ -42,6 +42,8 @@ class CSongState;
 class stChanNote;
 class CSoundGenBase;
 class CSoundChipSet;
+class CStateArchive;		// // //
+class CFrameProfiler;		// // //
 enum note_prio_t : unsigned;
 struct stEffectCommand;
 
@@ -53,6 +55,7 @@ public:
 	void SetupTracks();
 	void AssignModule(const CFamiTrackerModule &modfile);
 	void LoadAPU(CAPUInterface &apu);
+	void SetProfiler(CFrameProfiler *profiler);		// // //
 	void ConfigureDocument();
 
 	CTrackerChannel *GetTrackerChannel(stChannelID chan);
@@ -64,6 +67,7 @@ public:
 
 	void LoadSoundState(const CSongState &state);
 	void SetTempoCounter(std::shared_ptr<CTempoCounter> tempo);
+	void SerializeState(CStateArchive &ar);		// // //
 
 	void Tick();
 
@@ -139,6 +143,7 @@ private:
 	const CFamiTrackerModule *modfile_ = nullptr;		// // //
 	CSoundGenBase *parent_ = nullptr;		// // //
 	CAPUInterface *apu_ = nullptr;		// // //
+	CFrameProfiler *profiler_ = nullptr;		// // //
 
 	bool				m_bPlaying = false;
 	bool				m_bHaltRequest = false;
@@ -49,6 +49,7 @@ CSoundGen depends on CFamiTrackerView for:
 #include "APU/APU.h"
 #include "APU/2A03.h"		// // //
 #include "APU/Mixer.h"		// // // CHIP_LEVEL_*
+#include "APU/VGMWriter.h"		// // //
 #include "SoundChipSet.h"		// // //
 #include "ft0cc/doc/dpcm_sample.hpp"		// // //
 #include "InstrumentRecorder.h"		// // //
@@ -68,8 +69,14 @@ CSoundGen depends on CFamiTrackerView for:
 #include "Bookmark.h"		// // //
 #include "Instrument.h"
 #include "str_conv/str_conv.hpp"		// // //
-
-// // // Log VGM output (port from sn7t when necessary)
+#include "ChannelHandler.h"		// // //
+#include "PlaybackCheckpoints.h"		// // //
+#include "StateArchive.h"		// // //
+#include "FrameProfiler.h"		// // //
+#include "TraceRecorder.h"		// // //
+#include <stdexcept>		// // //
+
+// // // Log VGM output next to the module while playing
 //#define WRITE_VGM
 
 
@@ -77,6 +84,8 @@ CSoundGen depends on CFamiTrackerView for:
 namespace {
 
 const std::size_t DEFAULT_AVERAGE_BPM_SIZE = 24;
+const unsigned CHECKPOINT_FRAMES_PER_UPDATE = 16u;		// // // silent frames played per frame while stopped
+const unsigned CHECKPOINT_MAX_SEEK_FRAMES = CPlaybackCheckpoints::DEFAULT_INTERVAL;		// // // frames a seek may play forward during playback
 
 } // namespace
 
@@ -91,10 +100,11 @@ BEGIN_MESSAGE_MAP(CSoundGen, CWinThread)
 	ON_THREAD_MESSAGE(WM_USER_START_RENDER, OnStartRender)
 	ON_THREAD_MESSAGE(WM_USER_STOP_RENDER, OnStopRender)
 	ON_THREAD_MESSAGE(WM_USER_PREVIEW_SAMPLE, OnPreviewSample)
-	ON_THREAD_MESSAGE(WM_USER_WRITE_APU, OnWriteAPU)
 	ON_THREAD_MESSAGE(WM_USER_CLOSE_SOUND, OnCloseSound)
 	ON_THREAD_MESSAGE(WM_USER_SET_CHIP, OnSetChip)
 	ON_THREAD_MESSAGE(WM_USER_REMOVE_DOCUMENT, OnRemoveDocument)
+	ON_THREAD_MESSAGE(WM_USER_MOVE_TO_FRAME, OnMoveToFrame)		// // //
+	ON_THREAD_MESSAGE(WM_USER_SET_PROFILING, OnSetProfiling)		// // //
 END_MESSAGE_MAP()
 
 
@@ -112,6 +122,7 @@ CSoundGen::CSoundGen() :
 	m_bRunning(false),
 	m_hInterruptEvent(NULL),
 	m_pArpeggiator(std::make_unique<CArpeggiator>()),		// // //
+	m_pFrameProfiler(std::make_unique<CFrameProfiler>()),		// // //
 	m_pSequencePlayPos(NULL),
 	m_iSequencePlayPos(0),
 	m_iSequenceTimeout(0)
@@ -151,6 +162,7 @@ void CSoundGen::AssignDocument(CFamiTrackerDoc *pDoc)
 
 void CSoundGen::AssignModule(CFamiTrackerModule &modfile) {
 	m_pModule = &modfile;
+	InvalidateCheckpoints();		// // //
 	m_pInstRecorder->AssignModule(modfile);
 	m_pSoundDriver->AssignModule(modfile);
 	m_pTempoCounter->AssignModule(modfile);
@@ -210,6 +222,7 @@ void CSoundGen::ModuleChipChanged() {		// // //
 	// Change period tables
 	if (m_pModule)
 		LoadMachineSettings();
+	InvalidateCheckpoints();		// // //
 }
 
 void CSoundGen::SelectChip(CSoundChipSet Chip)
@@ -226,6 +239,12 @@ void CSoundGen::SelectChip(CSoundChipSet Chip)
 	PostThreadMessageW(WM_USER_SET_CHIP, Chip.GetFlag(), 0);
 }
 
+void CSoundGen::InvalidateCheckpoints()		// // //
+{
+	// Called from any thread, the player thread drops the index
+	m_bCheckpointsDirty = true;
+}
+
 void CSoundGen::DocumentPropertiesChanged(CFamiTrackerDoc *pDocument)
 {
 //	ASSERT(pDocument == m_pDocument);		// // //
@@ -300,11 +319,15 @@ void CSoundGen::PlaySingleRow(int track) {		// // //
 
 void CSoundGen::WriteAPU(int Address, char Value)
 {
+	// // // Called from main thread, the only producer of the write queue
+	ASSERT(GetCurrentThreadId() == FTEnv.GetMainApp()->m_nThreadID);
+
 	if (!m_hThread)
 		return;
 
-	// Direct APU interface
-	PostThreadMessageW(WM_USER_WRITE_APU, (WPARAM)Address, (LPARAM)Value);
+	// Direct APU interface, applied at the start of the next frame
+	if (!m_APUWrites.TryPush({static_cast<std::uint16_t>(Address), static_cast<std::uint8_t>(Value)}))
+		TRACE(L"SoundGen: APU write queue is full\n");
 }
 
 bool CSoundGen::IsExpansionEnabled(sound_chip_t Chip) const {		// // //
@@ -508,6 +531,13 @@ void CSoundGen::FlushBuffer(array_view<int16_t> Buffer)		// // //
 	m_pAudioDriver->FlushBuffer(Buffer);		// // //
 }
 
+void CSoundGen::FlushBuffer(array_view<float> Buffer)		// // //
+{
+	ASSERT(GetCurrentThreadId() == m_nThreadID);
+
+	m_pAudioDriver->FlushBuffer(Buffer);
+}
+
 // // //
 CDSound *CSoundGen::GetSoundInterface() const {
 	return m_pDSound.get();
@@ -559,6 +589,16 @@ unsigned int CSoundGen::GetFrameRate()
 	return std::exchange(m_iFrameCounter, 0);		// // //
 }
 
+void CSoundGen::SetProfiling(bool Enable)		// // //
+{
+	PostThreadMessageW(WM_USER_SET_PROFILING, Enable, 0);
+}
+
+const CFrameProfiler *CSoundGen::GetFrameProfiler() const		// // //
+{
+	return m_pFrameProfiler.get();
+}
+
 //// Tracker playing routines //////////////////////////////////////////////////////////////////////////////
 
 int CSoundGen::ReadPeriodTable(int Index, int Table) const		// // //
@@ -583,7 +623,11 @@ void CSoundGen::BeginPlayer(std::unique_ptr<CPlayerCursor> Pos)		// // //
 	m_iLastTrack		= cur.GetCurrentSong();		// // //
 
 #ifdef WRITE_VGM		// // //
-	m_pVGMWriter = std::make_unique<CVGMWriter>();
+	auto pVGMFile = std::make_shared<CSimpleFile>(fs::path {(LPCWSTR)m_pDocument->GetPathName()}.replace_extension(L".vgm"), std::ios::out | std::ios::binary);
+	if (*pVGMFile) {
+		m_pVGMWriter = std::make_unique<CVGMWriter>(std::move(pVGMFile));
+		m_pAPU->AddListener(*m_pVGMWriter);
+	}
 #endif
 
 	if (FTEnv.GetSettings()->Display.bAverageBPM)		// // // 050B
@@ -594,7 +638,9 @@ void CSoundGen::BeginPlayer(std::unique_ptr<CPlayerCursor> Pos)		// // //
 
 	MakeSilent();
 
-	if (FTEnv.GetSettings()->General.bRetrieveChanState)		// // //
+	bool Restored = FTEnv.GetSettings()->General.bCheckpointSeek &&		// // //
+		ApplyCheckpoint(cur.GetCurrentFrame(), cur.GetCurrentRow());
+	if (!Restored && FTEnv.GetSettings()->General.bRetrieveChanState)		// // //
 		ApplyGlobalState();
 
 	if (m_pInstRecorder->GetRecordChannel().Chip != sound_chip_t::none)		// // //
@@ -614,6 +660,82 @@ void CSoundGen::ApplyGlobalState()		// // //
 	m_iLastHighlight = m_pModule->GetSong(GetPlayerTrack())->GetHighlightAt(Frame, Row).First;
 }
 
+bool CSoundGen::ApplyCheckpoint(unsigned Frame, unsigned Row)		// // //
+{
+	// Called from player thread
+	ASSERT(GetCurrentThreadId() == m_nThreadID);
+
+	// the seek plays the module, so it must not change meanwhile; if the document
+	// is busy, the caller falls back to the usual way of starting at the row
+	return m_pDocument->Locked([&] {
+		UpdateCheckpoints();
+		CStateArchive State;
+		if (!m_pCheckpoints || !m_pCheckpoints->Seek(Frame, Row, State, CHECKPOINT_MAX_SEEK_FRAMES))
+			return false;
+
+		CSingleLock l(&m_csAPULock, TRUE);
+		try {
+			// same objects as CHeadlessRenderer::SerializePlayerState
+			State.BeginLoad();
+			State(*m_pAPU, *m_pSoundDriver);
+		}
+		catch (std::runtime_error &) {
+			// the index was set up differently, start from a clean state instead
+			m_pCheckpoints.reset();
+			ResetTempo();
+			ResetAPU();
+			MakeSilent();
+			return false;
+		}
+
+		// muted channels never received their notes
+		m_pSoundDriver->ForeachTrack([&] (CChannelHandler &Chan, CTrackerChannel &TrackerChan, stChannelID ID) {
+			if (IsChannelMuted(ID)) {
+				Chan.ResetChannel();
+				TrackerChan.Reset();
+			}
+		});
+
+		m_iLastHighlight = m_pModule->GetSong(m_iLastTrack)->GetHighlightAt(Frame, Row).First;
+		return true;
+	}, 0);
+}
+
+void CSoundGen::UpdateCheckpoints()		// // //
+{
+	// Called from player thread
+	const CSettings *pSettings = FTEnv.GetSettings();
+	const bool Enabled = pSettings->General.bCheckpointSeek && m_pModule;
+
+	if (m_bCheckpointsDirty.exchange(false) || !Enabled)
+		m_pCheckpoints.reset();
+	else if (m_pCheckpoints && m_pCheckpoints->GetTrack() != static_cast<unsigned>(m_iLastTrack))
+		m_pCheckpoints.reset();
+	if (m_pCheckpoints || !Enabled)
+		return;
+
+	// the silent pass must reach the same state as this thread's APU
+	stRenderSettings Settings;
+	Settings.SampleRate = pSettings->Sound.iSampleRate;
+	Settings.SampleSize = pSettings->Sound.iSampleSize;
+	Settings.BassFilter = pSettings->Sound.iBassFilter;
+	Settings.TrebleFilter = pSettings->Sound.iTrebleFilter;
+	Settings.TrebleDamping = pSettings->Sound.iTrebleDamping;
+	Settings.MixVolume = pSettings->Sound.iMixVolume;
+	Settings.LinearNamcoMixing = pSettings->bLinearNamcoMixing;
+	Settings.ChipLevels = {
+		{CHIP_LEVEL_APU1, pSettings->ChipLevels.iLevelAPU1 / 10.0f},
+		{CHIP_LEVEL_APU2, pSettings->ChipLevels.iLevelAPU2 / 10.0f},
+		{CHIP_LEVEL_VRC6, pSettings->ChipLevels.iLevelVRC6 / 10.0f},
+		{CHIP_LEVEL_VRC7, pSettings->ChipLevels.iLevelVRC7 / 10.0f},
+		{CHIP_LEVEL_MMC5, pSettings->ChipLevels.iLevelMMC5 / 10.0f},
+		{CHIP_LEVEL_FDS, pSettings->ChipLevels.iLevelFDS / 10.0f},
+		{CHIP_LEVEL_N163, pSettings->ChipLevels.iLevelN163 / 10.0f},
+		{CHIP_LEVEL_S5B, pSettings->ChipLevels.iLevelS5B / 10.0f},
+	};
+	m_pCheckpoints = std::make_unique<CPlaybackCheckpoints>(*m_pModule, m_iLastTrack, Settings);
+}
+
 // // //
 void CSoundGen::OnTick() {
 	if (m_pTempoDisplay)		// // // 050B
@@ -699,8 +821,8 @@ void CSoundGen::HaltPlayer() {
 
 #ifdef WRITE_VGM		// // //
 	if (m_pVGMWriter) {
-		m_pVGMWriter->SaveVGMFile();
-		m_pVGMWriter.reset();
+		m_pAPU->RemoveListener(*m_pVGMWriter);
+		m_pVGMWriter.reset();		// writes the header
 	}
 #endif
 }
@@ -832,6 +954,7 @@ void CSoundGen::LoadMachineSettings()		// // //
 		CSingleLock l(&m_csAPULock, TRUE);		// // //
 		m_pAPU->ChangeMachineRate(m_iMachineType, Rate);		// // //
 	}
+	InvalidateCheckpoints();		// // //
 }
 
 void CSoundGen::LoadSoundConfig() {		// // //
@@ -937,11 +1060,12 @@ bool CSoundGen::IsBackgroundTask() const
 // DPCM handling
 
 void CSoundGen::PlayPreviewSample(int Offset, int Pitch) {		// // //
+	ApplyAPUWrites();		// // // writes posted before the preview come first
+
 	int Loop = 0;
 	int Length = ((m_pPreviewSample->size() - 1) >> 4) - (Offset << 2);
 
-	if (auto *p2A03 = dynamic_cast<C2A03 *>(m_pAPU->GetSoundChip(sound_chip_t::APU)))		// // //
-		p2A03->WriteSample(std::move(m_pPreviewSample));		// // //
+	m_pAPU->WriteSample(std::move(m_pPreviewSample));		// // //
 
 	m_pAPU->Write(0x4010, Pitch | Loop);
 	m_pAPU->Write(0x4012, Offset);			// load address, start at $C000
@@ -994,6 +1118,7 @@ BOOL CSoundGen::InitInstance()
 
 	// Set running flag
 	m_bRunning = true;
+	FTEnv.GetTraceRecorder()->SetThreadName("Player");		// // //
 
 	if (!ResetAudioDevice()) {
 		TRACE(L"SoundGen: Failed to reset audio device!\n");
@@ -1044,7 +1169,11 @@ BOOL CSoundGen::IdleLoop() {
 	if (!IsAudioReady())		// // //
 		return TRUE;
 
+	CTraceScope trace {"Frame", "player"};		// // //
+
 	++m_iFrameCounter;
+	if (m_bProfiling)		// // //
+		m_pFrameProfiler->BeginFrame();
 
 	// Access the document object, skip if access wasn't granted to avoid gaps in audio playback
 	m_pDocument->Locked([this] {
@@ -1079,6 +1208,14 @@ BOOL CSoundGen::IdleLoop() {
 		HaltPlayer();
 	}
 
+	// // // Build the checkpoint index while stopped
+	if (!IsPlaying() && FTEnv.GetSettings()->General.bCheckpointSeek)
+		m_pDocument->Locked([this] {
+			UpdateCheckpoints();
+			if (m_pCheckpoints)
+				m_pCheckpoints->Advance(CHECKPOINT_FRAMES_PER_UPDATE);
+		}, 0);
+
 	return TRUE;
 }
 
@@ -1089,6 +1226,8 @@ void CSoundGen::UpdateAPU()
 	m_bWaveChanged = false;
 
 	if (CSingleLock l(&m_csAPULock); l.Lock()) {
+		ApplyAPUWrites();		// // //
+
 		// Update APU channel registers
 		int cycles = m_iUpdateCycles;
 		sound_chip_t LastChip = sound_chip_t::none;		// // // 050B
@@ -1110,11 +1249,16 @@ void CSoundGen::UpdateAPU()
 		m_pAPU->AddTime(cycles);
 		m_pAPU->Process();
 		m_pAPU->EndFrame();		// // //
+	}
 
-#ifdef WRITE_VGM		// // //
-		if (m_pVGMWriter)
-			m_pVGMWriter->Tick();		// // //
-#endif
+	// // // Waiting for the device is not part of the frame
+	if (m_bProfiling)
+		m_pFrameProfiler->EndFrame();
+
+	// // // Wait for the device only after the lock is released
+	{
+		CTraceScope trace {"Wait for audio", "audio"};
+		m_pAudioDriver->PlayBlocks();
 	}
 
 #ifdef LOGGING
@@ -1123,6 +1267,15 @@ void CSoundGen::UpdateAPU()
 #endif
 }
 
+void CSoundGen::ApplyAPUWrites()		// // //
+{
+	// Called from player thread, the only consumer of the write queue
+	ASSERT(GetCurrentThreadId() == m_nThreadID);
+
+	for (stAPUWrite *pWrite; (pWrite = m_APUWrites.Front()) != nullptr; m_APUWrites.Pop())
+		m_pAPU->Write(pWrite->Address, pWrite->Value);
+}
+
 // End of overloaded functions
 
 // Thread message handler
@@ -1144,6 +1297,7 @@ void CSoundGen::OnLoadSettings(WPARAM wParam, LPARAM lParam)
 		if (m_pVisualizerWnd != NULL)
 			m_pVisualizerWnd->ReportAudioProblem();
 	}
+	InvalidateCheckpoints();		// // //
 }
 
 void CSoundGen::OnStopPlayer(WPARAM wParam, LPARAM lParam)
@@ -1177,11 +1331,6 @@ void CSoundGen::OnPreviewSample(WPARAM wParam, LPARAM lParam)
 	PlayPreviewSample(wParam, lParam);
 }
 
-void CSoundGen::OnWriteAPU(WPARAM wParam, LPARAM lParam)
-{
-	m_pAPU->Write((uint16_t)wParam, (uint8_t)lParam);
-}
-
 void CSoundGen::OnCloseSound(WPARAM wParam, LPARAM lParam)
 {
 	CloseAudio();
@@ -1221,9 +1370,26 @@ void CSoundGen::OnRemoveDocument(WPARAM wParam, LPARAM lParam)
 	//if (*m_pDumpInstrument)		// // //
 	//	(*m_pDumpInstrument)->Release();
 	m_pInstRecorder->ResetRecordCache();
+	m_pCheckpoints.reset();		// // //
 	TRACE(L"SoundGen: Document removed\n");
 }
 
+void CSoundGen::OnMoveToFrame(WPARAM wParam, LPARAM lParam)		// // //
+{
+	if (IsPlaying() && !ApplyCheckpoint(static_cast<unsigned>(wParam), 0u))
+		if (auto cursor = m_pSoundDriver->GetPlayerCursor())
+			cursor->SetPosition(static_cast<unsigned>(wParam), 0u);
+}
+
+void CSoundGen::OnSetProfiling(WPARAM wParam, LPARAM lParam)		// // //
+{
+	m_bProfiling = wParam != 0;
+	m_pFrameProfiler->Reset();
+	CFrameProfiler *pProfiler = m_bProfiling ? m_pFrameProfiler.get() : nullptr;
+	m_pAPU->SetProfiler(pProfiler);
+	m_pSoundDriver->SetProfiler(pProfiler);
+}
+
 // FDS & N163
 
 void CSoundGen::WaveChanged()
@@ -1240,6 +1406,7 @@ bool CSoundGen::HasWaveChanged() const
 void CSoundGen::SetNamcoMixing(bool bLinear)		// // //
 {
 	m_pAPU->SetNamcoMixing(bLinear);
+	InvalidateCheckpoints();		// // //
 }
 
 // Player state functions
@@ -1276,6 +1443,11 @@ int CSoundGen::GetPlayerTicks() const
 
 void CSoundGen::MoveToFrame(int Frame)
 {
+	if (FTEnv.GetSettings()->General.bCheckpointSeek) {		// // // let the player thread restore the exact state
+		PostThreadMessageW(WM_USER_MOVE_TO_FRAME, Frame, 0);
+		return;
+	}
+
 	// Todo: synchronize
 	if (auto cursor = m_pSoundDriver->GetPlayerCursor())
 		cursor->SetPosition(Frame, 0);		// // //
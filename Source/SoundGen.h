@@ -33,7 +33,9 @@
 #include <vector>		// // //
 #include <map>		// // //
 #include <memory>		// // //
+#include <atomic>		// // //
 #include "SoundGenBase.h"		// // //
+#include "SPSCQueue.h"		// // //
 #include "APU/Types.h"
 #include "ft0cc/fs.h"		// // //
 
@@ -47,11 +49,12 @@ enum {
 	WM_USER_START_RENDER,
 	WM_USER_STOP_RENDER,
 	WM_USER_PREVIEW_SAMPLE,
-	WM_USER_WRITE_APU,
 	WM_USER_CLOSE_SOUND,
 	WM_USER_SET_CHIP,
 	WM_USER_VERIFY_EXPORT,
 	WM_USER_REMOVE_DOCUMENT,
+	WM_USER_MOVE_TO_FRAME,		// // //
+	WM_USER_SET_PROFILING,		// // //
 };
 
 class stChanNote;		// // //
@@ -81,6 +84,9 @@ class CPlayerCursor;		// // //
 class CSoundDriver;		// // //
 class CSoundChipSet;		// // //
 class CSimpleFile;		// // //
+class CVGMWriter;		// // //
+class CPlaybackCheckpoints;		// // //
+class CFrameProfiler;		// // //
 
 namespace ft0cc::doc {
 class dpcm_sample;
@@ -117,6 +123,7 @@ public:
 	// Sound
 	bool		InitializeSound(HWND hWnd);
 	void		FlushBuffer(array_view<int16_t> Buffer) override;
+	void		FlushBuffer(array_view<float> Buffer) override;		// // //
 	CDSound		*GetSoundInterface() const;		// // //
 	CAudioDriver *GetAudioDriver() const;		// // //
 
@@ -127,6 +134,7 @@ public:
 	bool		Shutdown();		// // //
 
 	void		DocumentPropertiesChanged(CFamiTrackerDoc *pDocument);
+	void		InvalidateCheckpoints();		// // // module or sound settings changed
 
 public:
 	int			 ReadPeriodTable(int Index, int Table) const;		// // //
@@ -155,6 +163,8 @@ public:
 
 	// Stats
 	unsigned int GetFrameRate();
+	void		 SetProfiling(bool Enable);		// // // clears the statistics
+	const CFrameProfiler *GetFrameProfiler() const;		// // //
 
 	// Tracker playing
 	stDPCMState	 GetDPCMState() const;
@@ -232,6 +242,7 @@ private:
 
 	// Player
 	void		UpdateAPU();
+	void		ApplyAPUWrites();		// // //
 	void		ResetBuffer();
 	void		BeginPlayer(std::unique_ptr<CPlayerCursor> Pos);		// // //
 	void		HaltPlayer();
@@ -246,6 +257,8 @@ private:
 	double		GetAverageBPM() const;		// // //
 
 	void		ApplyGlobalState();		// // //
+	bool		ApplyCheckpoint(unsigned Frame, unsigned Row);		// // //
+	void		UpdateCheckpoints();		// // //
 
 	// // // CSoundGenBase impl
 	CInstrumentManager *GetInstrumentManager() const override;
@@ -306,9 +319,25 @@ private:
 	std::shared_ptr<CWaveRenderer> m_pWaveRenderer;			// // //
 	std::shared_ptr<CSimpleFile> m_pRenderFile;				// // //
 	std::unique_ptr<CInstrumentRecorder> m_pInstRecorder;
+	std::unique_ptr<CVGMWriter> m_pVGMWriter;				// // //
 
 	std::map<stChannelID, bool> muted_;						// // //
 
+	// // // Checkpoint index, owned by the player thread
+	std::unique_ptr<CPlaybackCheckpoints> m_pCheckpoints;
+	std::atomic<bool>	m_bCheckpointsDirty {false};
+
+	// // // Frame timings, read by the performance dialog
+	std::unique_ptr<CFrameProfiler> m_pFrameProfiler;
+	bool				m_bProfiling = false;				// owned by the player thread
+
+	// // // Direct APU writes from the main thread, applied by the player thread
+	struct stAPUWrite {
+		std::uint16_t Address;
+		std::uint8_t Value;
+	};
+	CSPSCQueue<stAPUWrite> m_APUWrites {256u};
+
 	// FDS & N163 waves
 	volatile bool		m_bWaveChanged;
 	volatile bool		m_bInternalWaveChanged;
@@ -337,8 +366,9 @@ public:
 	afx_msg void OnStopRender(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnPreviewSample(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnHaltPreview(WPARAM wParam, LPARAM lParam);
-	afx_msg void OnWriteAPU(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnCloseSound(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnSetChip(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnRemoveDocument(WPARAM wParam, LPARAM lParam);
+	afx_msg void OnMoveToFrame(WPARAM wParam, LPARAM lParam);		// // //
+	afx_msg void OnSetProfiling(WPARAM wParam, LPARAM lParam);		// // //
 };
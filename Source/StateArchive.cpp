@@ -0,0 +1,73 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "StateArchive.h"
+#include <cstring>
+#include <stdexcept>
+
+void CStateArchive::BeginSave() {
+	data_.clear();
+	refs_.clear();
+	pos_ = refPos_ = 0u;
+	loading_ = false;
+}
+
+void CStateArchive::BeginLoad() {
+	pos_ = refPos_ = 0u;
+	loading_ = true;
+}
+
+bool CStateArchive::IsLoading() const {
+	return loading_;
+}
+
+bool CStateArchive::IsEmpty() const {
+	return data_.empty();
+}
+
+std::size_t CStateArchive::GetSize() const {
+	return data_.size();
+}
+
+void CStateArchive::Bytes(void *p, std::size_t n) {
+	if (loading_) {
+		if (n > data_.size() - pos_)
+			throw std::runtime_error("State snapshot does not match the objects it is restored onto");
+		std::memcpy(p, data_.data() + pos_, n);
+	}
+	else {
+		data_.resize(pos_ + n);
+		std::memcpy(data_.data() + pos_, p, n);
+	}
+	pos_ += n;
+}
+
+void CStateArchive::Ref(std::shared_ptr<const void> &ref) {
+	if (loading_) {
+		if (refPos_ >= refs_.size())
+			throw std::runtime_error("State snapshot does not match the objects it is restored onto");
+		ref = refs_[refPos_];
+	}
+	else
+		refs_.push_back(ref);
+	++refPos_;
+}
@@ -0,0 +1,148 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <array>
+#include <vector>
+#include <optional>
+#include <type_traits>
+
+// // // in-memory snapshot of everything that changes while a module plays
+//
+// Each class with playback state has one SerializeState(CStateArchive &) that
+// lists its members; the same method stores them or restores them, depending on
+// which mode the archive is in, so that saving and loading cannot drift apart.
+// Configuration, such as the sample rate, the machine, the expansion chips and
+// the mixer settings, is not stored; a snapshot is restored onto objects set up
+// the same way. Objects owned by the module, such as sequences, grooves and DPCM
+// samples, are kept by reference, so snapshots only live in memory and are only
+// valid for the module they were taken from.
+
+class CStateArchive;
+
+namespace details {
+
+template <typename T, typename = void>
+struct has_serialize_state : std::false_type { };
+template <typename T>
+struct has_serialize_state<T, std::void_t<
+	decltype(std::declval<T &>().SerializeState(std::declval<CStateArchive &>()))>> : std::true_type { };
+
+// arrays of objects are visited one by one, arrays of plain values are copied at once
+template <typename T>
+struct is_state_object_array : std::false_type { };
+template <typename T, std::size_t N>
+struct is_state_object_array<T[N]> : has_serialize_state<T> { };
+template <typename T, std::size_t N>
+struct is_state_object_array<std::array<T, N>> : has_serialize_state<T> { };
+
+template <typename T>
+struct is_state_vector : std::false_type { };
+template <typename T, typename A>
+struct is_state_vector<std::vector<T, A>> : std::true_type { };
+
+template <typename T>
+struct is_state_optional : std::false_type { };
+template <typename T>
+struct is_state_optional<std::optional<T>> : std::true_type { };
+
+template <typename T>
+struct is_state_ref : std::false_type { };
+template <typename T>
+struct is_state_ref<std::shared_ptr<T>> : std::true_type { };
+
+} // namespace details
+
+class CStateArchive {
+public:
+	void BeginSave();		// discards the current snapshot
+	void BeginLoad();		// rewinds to the start of the snapshot
+	bool IsLoading() const;
+	bool IsEmpty() const;
+	std::size_t GetSize() const;		// bytes used, not counting referenced objects
+
+	template <typename... Ts>
+	void operator()(Ts &... xs) {
+		(Serialize(xs), ...);
+	}
+
+private:
+	template <typename T>
+	void Serialize(T &x) {
+		if constexpr (details::has_serialize_state<T>::value)
+			x.SerializeState(*this);
+		else if constexpr (details::is_state_object_array<T>::value) {
+			for (auto &elem : x)
+				Serialize(elem);
+		}
+		else if constexpr (details::is_state_vector<T>::value) {
+			std::size_t n = x.size();
+			Bytes(&n, sizeof(n));
+			if (loading_)
+				x.resize(n);
+			if constexpr (std::is_trivially_copyable_v<typename T::value_type> && !details::has_serialize_state<typename T::value_type>::value)
+				Bytes(x.data(), n * sizeof(typename T::value_type));
+			else
+				for (auto &elem : x)
+					Serialize(elem);
+		}
+		else if constexpr (details::is_state_optional<T>::value) {
+			bool has = x.has_value();
+			Bytes(&has, sizeof(has));
+			if (loading_ && has != x.has_value()) {
+				if (has)
+					x.emplace();
+				else
+					x.reset();
+			}
+			if (has)
+				Serialize(*x);
+		}
+		else if constexpr (details::is_state_ref<T>::value) {
+			using elem_t = typename T::element_type;
+			std::shared_ptr<const void> ref = x;
+			Ref(ref);
+			if (loading_)
+				x = std::const_pointer_cast<elem_t>(std::static_pointer_cast<const elem_t>(ref));
+		}
+		else {
+			static_assert(std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>,
+				"Type must be trivially copyable or have a SerializeState method");
+			Bytes(&x, sizeof(T));
+		}
+	}
+
+	void Bytes(void *p, std::size_t n);
+	void Ref(std::shared_ptr<const void> &ref);
+
+private:
+	std::vector<std::uint8_t> data_;
+	std::vector<std::shared_ptr<const void>> refs_;
+	std::size_t pos_ = 0u;
+	std::size_t refPos_ = 0u;
+	bool loading_ = false;
+};
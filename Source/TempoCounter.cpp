@@ -25,6 +25,7 @@
 #include "SongData.h"
 #include "SongState.h"
 #include "ft0cc/doc/groove.hpp"
+#include "StateArchive.h"		// // //
 
 // // // CTempoCounter
 
@@ -128,6 +129,10 @@ void CTempoCounter::LoadSoundState(const CSongState &state) {
 	SetupSpeed();
 }
 
+void CTempoCounter::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_pCurrentGroove, m_iTempo, m_iSpeed, m_iGroovePosition, m_iTempoAccum, m_iTempoDecrement, m_iTempoRemainder);
+}
+
 void CTempoCounter::SetupSpeed() {
 	if (m_iTempo) {		// // //
 		m_iTempoDecrement = (m_iTempo * 24) / m_iSpeed;
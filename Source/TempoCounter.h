@@ -29,6 +29,7 @@
 class CSongData;
 class CFamiTrackerModule;
 class CSongState;
+class CStateArchive;		// // //
 
 namespace ft0cc::doc {
 class groove;
@@ -50,6 +51,7 @@ public:
 	void DoFxx(uint8_t Param);
 	void DoOxx(uint8_t Param);
 	void LoadSoundState(const CSongState &state);
+	void SerializeState(CStateArchive &ar);		// // //
 
 private:
 	void SetupSpeed();
@@ -0,0 +1,283 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "TraceRecorder.h"
+#include <cstdio>
+#include "SimpleFile.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+
+namespace {
+
+std::atomic<std::uint64_t> g_iNextRecorderID {1u};
+
+// the buffer of the calling thread, valid for one recorder
+thread_local struct {
+	std::uint64_t RecorderID = 0u;
+	void *pBuffer = nullptr;
+} t_Buffer;
+
+void AppendEscaped(std::string &out, std::string_view str) {
+	for (char ch : str) {
+		if (ch == '"' || ch == '\\')
+			out += '\\';
+		if (static_cast<unsigned char>(ch) >= 0x20u)
+			out += ch;
+	}
+}
+
+void AppendMicroseconds(std::string &out, std::int64_t ns) {
+	char buf[32];
+	unsigned long long mag = ns < 0 ? 0ull - static_cast<unsigned long long>(ns) : static_cast<unsigned long long>(ns);
+	std::snprintf(buf, std::size(buf), "%s%llu.%03llu", ns < 0 ? "-" : "", mag / 1000u, mag % 1000u);
+	out += buf;
+}
+
+} // namespace
+
+// events are stored in chunks that never move, so the reader can follow the
+// writer without locking; a buffer is cleared by its own thread when it sees
+// that a new recording has started
+class CTraceRecorder::CThreadBuffer {
+public:
+	static constexpr std::size_t CHUNK_SIZE = 4096u;
+	static constexpr std::size_t MAX_CHUNKS = 1024u;		// 4M events per thread and recording
+
+	explicit CThreadBuffer(std::uint32_t ThreadID) : m_iThreadID(ThreadID) {
+	}
+	~CThreadBuffer() {
+		for (auto &pChunk : m_pChunks)
+			delete[] pChunk.load(std::memory_order_relaxed);
+	}
+
+	void Add(const stTraceEvent &Event, std::uint32_t Session) {
+		if (m_iSession.load(std::memory_order_relaxed) != Session) {
+			m_iCount.store(0u, std::memory_order_relaxed);
+			m_iDropped.store(0u, std::memory_order_relaxed);
+			m_iSession.store(Session, std::memory_order_release);
+		}
+
+		std::size_t Index = m_iCount.load(std::memory_order_relaxed);
+		std::size_t Chunk = Index / CHUNK_SIZE;
+		if (Chunk >= MAX_CHUNKS) {
+			m_iDropped.fetch_add(1u, std::memory_order_relaxed);
+			return;
+		}
+		stTraceEvent *pChunk = m_pChunks[Chunk].load(std::memory_order_relaxed);
+		if (!pChunk) {
+			pChunk = new stTraceEvent[CHUNK_SIZE];
+			m_pChunks[Chunk].store(pChunk, std::memory_order_release);
+		}
+		pChunk[Index % CHUNK_SIZE] = Event;
+		m_iCount.store(Index + 1, std::memory_order_release);
+	}
+
+	// number of events that belong to the given recording
+	std::size_t GetCount(std::uint32_t Session) const {
+		if (m_iSession.load(std::memory_order_acquire) != Session)
+			return 0u;
+		return m_iCount.load(std::memory_order_acquire);
+	}
+
+	std::size_t GetDropped(std::uint32_t Session) const {
+		if (m_iSession.load(std::memory_order_acquire) != Session)
+			return 0u;
+		return m_iDropped.load(std::memory_order_relaxed);
+	}
+
+	const stTraceEvent &GetEvent(std::size_t Index) const {
+		return m_pChunks[Index / CHUNK_SIZE].load(std::memory_order_acquire)[Index % CHUNK_SIZE];
+	}
+
+	std::uint32_t GetThreadID() const {
+		return m_iThreadID;
+	}
+
+	std::string Name;		// guarded by the recorder's list lock
+
+private:
+	const std::uint32_t m_iThreadID;
+	std::atomic<std::uint32_t> m_iSession {0u};
+	std::atomic<std::size_t> m_iCount {0u};
+	std::atomic<std::size_t> m_iDropped {0u};
+	std::array<std::atomic<stTraceEvent *>, MAX_CHUNKS> m_pChunks = { };
+};
+
+
+
+CTraceRecorder::CTraceRecorder() : m_iRecorderID(g_iNextRecorderID++) {
+}
+
+CTraceRecorder::~CTraceRecorder() {
+}
+
+void CTraceRecorder::Start() {
+	if (IsRecording())
+		return;
+	m_tOrigin.store(clock_t::now().time_since_epoch().count(), std::memory_order_relaxed);
+	m_iSession.fetch_add(1u, std::memory_order_release);
+	m_bRecording.store(true, std::memory_order_release);
+}
+
+void CTraceRecorder::Stop() {
+	m_bRecording.store(false, std::memory_order_release);
+}
+
+void CTraceRecorder::AddSpan(const stTraceEvent &Event, std::uint32_t Session) {
+	if (Session == GetSession())
+		GetThreadBuffer().Add(Event, Session);
+}
+
+std::uint32_t CTraceRecorder::GetSession() const noexcept {
+	return m_iSession.load(std::memory_order_acquire);
+}
+
+std::int64_t CTraceRecorder::GetTime(clock_t::time_point Time) const noexcept {
+	auto Origin = clock_t::time_point {clock_t::duration {m_tOrigin.load(std::memory_order_relaxed)}};
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Time - Origin).count();
+}
+
+void CTraceRecorder::SetThreadName(std::string Name) {
+	CThreadBuffer &Buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock {m_BuffersLock};
+	Buffer.Name = std::move(Name);
+}
+
+CTraceRecorder::CThreadBuffer &CTraceRecorder::GetThreadBuffer() {
+	if (t_Buffer.RecorderID != m_iRecorderID) {
+		std::lock_guard<std::mutex> lock {m_BuffersLock};
+		auto &pBuffer = m_pBuffers.emplace_back(std::make_unique<CThreadBuffer>(static_cast<std::uint32_t>(m_pBuffers.size() + 1)));
+		t_Buffer.RecorderID = m_iRecorderID;
+		t_Buffer.pBuffer = pBuffer.get();
+	}
+	return *static_cast<CThreadBuffer *>(t_Buffer.pBuffer);
+}
+
+void CTraceRecorder::Write(CSimpleFile &file) const {
+	const std::uint32_t Session = m_iSession.load(std::memory_order_relaxed);
+	const CSoundChipService *pService = FTEnv.GetSoundChipService();
+
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool First = true;
+	auto Flush = [&] (bool Force) {
+		if (Force || out.size() >= 0x10000u) {
+			file.WriteBytes(array_view<char> {out.data(), out.size()});
+			out.clear();
+		}
+	};
+	auto BeginEvent = [&] (const char *Name, std::uint32_t ThreadID) {
+		out += First ? "{\"name\":\"" : ",\n{\"name\":\"";
+		First = false;
+		AppendEscaped(out, Name);
+		out += "\",\"pid\":1,\"tid\":";
+		out += std::to_string(ThreadID);
+	};
+
+	std::lock_guard<std::mutex> lock {m_BuffersLock};
+	for (const auto &pBuffer : m_pBuffers) {
+		std::size_t Count = pBuffer->GetCount(Session);
+		if (!Count && pBuffer->Name.empty())
+			continue;
+
+		BeginEvent("thread_name", pBuffer->GetThreadID());
+		out += ",\"ph\":\"M\",\"args\":{\"name\":\"";
+		AppendEscaped(out, pBuffer->Name.empty() ? "Thread " + std::to_string(pBuffer->GetThreadID()) : pBuffer->Name);
+		out += "\"}}";
+
+		for (std::size_t i = 0; i < Count; ++i) {
+			const stTraceEvent &Event = pBuffer->GetEvent(i);
+			if (Event.Chip == sound_chip_t::none)
+				BeginEvent(Event.Name, pBuffer->GetThreadID());
+			else
+				BeginEvent((std::string {Event.Name} + " (" + std::string {pService->GetChipShortName(Event.Chip)} + ')').data(), pBuffer->GetThreadID());
+			out += ",\"cat\":\"";
+			out += Event.Category;
+			out += "\",\"ph\":\"X\",\"ts\":";
+			AppendMicroseconds(out, Event.Begin);
+			out += ",\"dur\":";
+			AppendMicroseconds(out, Event.Duration);
+			if (Event.ArgNames[0]) {
+				out += ",\"args\":{";
+				for (std::size_t j = 0; j < Event.ArgNames.size() && Event.ArgNames[j]; ++j) {
+					out += j ? ",\"" : "\"";
+					out += Event.ArgNames[j];
+					out += "\":";
+					out += std::to_string(Event.Args[j]);
+				}
+				out += '}';
+			}
+			out += '}';
+			Flush(false);
+		}
+	}
+
+	out += "\n]}\n";
+	Flush(true);
+}
+
+std::size_t CTraceRecorder::GetEventCount() const {
+	const std::uint32_t Session = m_iSession.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock {m_BuffersLock};
+	std::size_t Count = 0u;
+	for (const auto &pBuffer : m_pBuffers)
+		Count += pBuffer->GetCount(Session);
+	return Count;
+}
+
+std::size_t CTraceRecorder::GetDroppedCount() const {
+	const std::uint32_t Session = m_iSession.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock {m_BuffersLock};
+	std::size_t Count = 0u;
+	for (const auto &pBuffer : m_pBuffers)
+		Count += pBuffer->GetDropped(Session);
+	return Count;
+}
+
+
+
+CTraceScope::CTraceScope(const char *Name, const char *Category, sound_chip_t Chip) noexcept :
+	m_pRecorder(FTEnv.GetTraceRecorder()),
+	m_Event {Name, Category, 0, 0, Chip, { }, { }}
+{
+	if (!m_pRecorder->IsRecording())
+		m_pRecorder = nullptr;
+	else {
+		m_iSession = m_pRecorder->GetSession();
+		m_tStart = CTraceRecorder::clock_t::now();
+	}
+}
+
+CTraceScope::~CTraceScope() noexcept {
+	if (m_pRecorder && m_pRecorder->IsRecording()) {
+		auto End = CTraceRecorder::clock_t::now();
+		m_Event.Begin = m_pRecorder->GetTime(m_tStart);
+		m_Event.Duration = std::chrono::duration_cast<std::chrono::nanoseconds>(End - m_tStart).count();
+		m_pRecorder->AddSpan(m_Event, m_iSession);
+	}
+}
+
+void CTraceScope::SetArg(std::size_t Index, const char *Name, std::int32_t Value) noexcept {
+	if (Index < m_Event.Args.size()) {
+		m_Event.ArgNames[Index] = Name;
+		m_Event.Args[Index] = Value;
+	}
+}
@@ -0,0 +1,112 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "APU/Types.h"
+
+class CSimpleFile;
+
+// // // timeline of spans from any thread, written as Chrome trace-event JSON
+//
+// Every thread that records a span gets its own buffer, which only that thread
+// writes to; a span is appended without locking and published by bumping the
+// buffer's event count, so recording never waits on the reader or on other
+// threads. Names, categories and argument names must be string literals.
+
+struct stTraceEvent {
+	const char *Name;
+	const char *Category;
+	std::int64_t Begin;			// nanoseconds since the recording started
+	std::int64_t Duration;		// nanoseconds
+	sound_chip_t Chip;			// appended to the name if not none
+	std::array<const char *, 2> ArgNames;
+	std::array<std::int32_t, 2> Args;
+};
+
+class CTraceRecorder {
+public:
+	using clock_t = std::chrono::steady_clock;
+
+	CTraceRecorder();
+	~CTraceRecorder();
+
+	// starting discards the previous recording
+	void Start();
+	void Stop();
+	bool IsRecording() const noexcept {
+		return m_bRecording.load(std::memory_order_relaxed);
+	}
+
+	// spans are only added to the recording that was running when they began
+	void AddSpan(const stTraceEvent &Event, std::uint32_t Session);
+	std::int64_t GetTime(clock_t::time_point Time) const noexcept;
+	std::uint32_t GetSession() const noexcept;
+
+	// names the calling thread in the trace
+	void SetThreadName(std::string Name);
+
+	// call after Stop, not while another recording is running
+	void Write(CSimpleFile &file) const;
+	std::size_t GetEventCount() const;
+	std::size_t GetDroppedCount() const;
+
+private:
+	class CThreadBuffer;
+	CThreadBuffer &GetThreadBuffer();
+
+	std::atomic<bool> m_bRecording {false};
+	std::atomic<std::uint32_t> m_iSession {0u};
+	std::atomic<clock_t::rep> m_tOrigin {0};
+	std::uint64_t m_iRecorderID;
+
+	mutable std::mutex m_BuffersLock;		// guards the list, not the buffers
+	std::vector<std::unique_ptr<CThreadBuffer>> m_pBuffers;
+};
+
+// // // records the enclosing scope as a span if a trace is being recorded
+class CTraceScope {
+public:
+	CTraceScope(const char *Name, const char *Category, sound_chip_t Chip = sound_chip_t::none) noexcept;
+	~CTraceScope() noexcept;
+
+	void SetArg(std::size_t Index, const char *Name, std::int32_t Value) noexcept;
+
+	CTraceScope(const CTraceScope &) = delete;
+	CTraceScope &operator=(const CTraceScope &) = delete;
+
+private:
+	CTraceRecorder *m_pRecorder;		// nullptr if not recording
+	std::uint32_t m_iSession = 0u;
+	stTraceEvent m_Event;
+	CTraceRecorder::clock_t::time_point m_tStart;
+};
@@ -0,0 +1,138 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "TraceRenderer.h"
+#include "APU/APU.h"
+#include "APU/RegisterTrace.h"
+#include "APU/VGMWriter.h"
+#include "WaveStream.h"
+#include "SimpleFile.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+
+CTraceRenderer::CTraceRenderer(const CRegisterTrace &trace, const stRenderSettings &settings) :
+	trace_(trace),
+	settings_(settings),
+	apu_(std::make_unique<CAPU>(this))
+{
+	SetupSound();
+}
+
+CTraceRenderer::~CTraceRenderer() {
+}
+
+// same settings as CHeadlessRenderer, the chips are set up by the trace itself
+void CTraceRenderer::SetupSound() {
+	apu_->SetupSound(settings_.SampleRate, settings_.Channels, trace_.GetMachine(), settings_.FloatOutput);
+	apu_->SetupMixer(settings_.BassFilter, settings_.TrebleFilter, settings_.TrebleDamping, settings_.MixVolume);
+	apu_->SetNamcoMixing(settings_.LinearNamcoMixing);
+	apu_->SetSynthQuality(settings_.SynthQuality);
+
+	CSoundChipSet chips = trace_.GetChips();
+	FTEnv.GetSoundChipService()->ForeachTrack([&] (stChannelID ch) {
+		if (!chips.ContainsChip(ch.Chip))
+			return;
+		auto name = FTEnv.GetSoundChipService()->GetChannelShortName(ch);
+		for (const auto &[Name, Pan] : settings_.ChannelPans)
+			if (name == Name)
+				apu_->SetChannelPan(ch, Pan / 100.f);
+	});
+}
+
+bool CTraceRenderer::RenderToFile(const fs::path &fname) {
+	auto pFile = std::make_shared<CSimpleFile>(fname, std::ios::out | std::ios::binary);
+	if (!*pFile)
+		return false;
+
+	CWaveFileFormat fmt {
+		settings_.FloatOutput ? CWaveFileFormat::format_code::ieee_float : CWaveFileFormat::format_code::pcm,
+		static_cast<std::uint16_t>(settings_.Channels),
+		static_cast<std::uint32_t>(settings_.SampleRate),
+		static_cast<std::uint16_t>(settings_.FloatOutput ? 32u : settings_.SampleSize),
+	};
+	COutputWaveStream stream {pFile, fmt};
+
+	if (settings_.VGMOutput) {
+		auto pVGMFile = std::make_shared<CSimpleFile>(fs::path {fname}.replace_extension(".vgm"), std::ios::out | std::ios::binary);
+		if (!*pVGMFile)
+			return false;
+		vgm_ = std::make_unique<CVGMWriter>(std::move(pVGMFile));
+		apu_->AddListener(*vgm_);
+	}
+	Render(stream);
+	if (vgm_) {
+		apu_->RemoveListener(*vgm_);
+		vgm_->Close();
+	}
+
+	return true;
+}
+
+void CTraceRenderer::Render(COutputWaveStream &stream) {
+	stream_ = &stream;
+	frames_ = 0u;
+	samples_ = 0u;
+
+	// events after the last frame only silence the APU
+	stream.WriteWAVHeader();
+	std::size_t Pos = 0u;
+	for (; frames_ < trace_.GetFrameCount(); ++frames_)
+		Pos = trace_.ReplayFrame(*apu_, Pos);
+
+	stream_ = nullptr;
+}
+
+unsigned CTraceRenderer::GetRenderedFrames() const {
+	return frames_;
+}
+
+std::size_t CTraceRenderer::GetRenderedSamples() const {
+	return samples_;
+}
+
+const CVGMWriter *CTraceRenderer::GetVGMWriter() const {
+	return vgm_.get();
+}
+
+void CTraceRenderer::FlushBuffer(array_view<int16_t> Buffer) {
+	FlushBufferImpl(Buffer);
+}
+
+void CTraceRenderer::FlushBuffer(array_view<float> Buffer) {
+	FlushBufferImpl(Buffer);
+}
+
+template <typename T>
+void CTraceRenderer::FlushBufferImpl(array_view<T> Buffer) {
+	if (!stream_)
+		return;
+
+	samples_ += Buffer.size() / settings_.Channels;		// counted per channel
+	if constexpr (std::is_integral_v<T>)
+		if (settings_.SampleSize == 8)
+			return stream_->WriteSamples(ConvertTo8Bit(Buffer, conv_));
+	stream_->WriteSamples(Buffer);
+}
+
+bool CTraceRenderer::PlayBuffer() {
+	return true;
+}
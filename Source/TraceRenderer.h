@@ -0,0 +1,72 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <vector>
+#include "Common.h"
+#include "HeadlessRenderer.h"
+#include "ft0cc/fs.h"
+
+class CAPU;
+class CRegisterTrace;
+class COutputWaveStream;
+class CVGMWriter;
+
+// // // renders a register trace through a new APU, without a module or the
+// sound driver; ChannelStems and RegisterTrace are not supported
+class CTraceRenderer : public IAudioCallback {
+public:
+	explicit CTraceRenderer(const CRegisterTrace &trace, const stRenderSettings &settings = { });
+	~CTraceRenderer();
+
+	bool RenderToFile(const fs::path &fname);
+	void Render(COutputWaveStream &stream);
+
+	unsigned GetRenderedFrames() const;
+	std::size_t GetRenderedSamples() const;
+	const CVGMWriter *GetVGMWriter() const;
+
+private:
+	void SetupSound();
+	template <typename T>
+	void FlushBufferImpl(array_view<T> Buffer);
+
+	// IAudioCallback impl
+	void FlushBuffer(array_view<int16_t> Buffer) override;
+	void FlushBuffer(array_view<float> Buffer) override;
+	bool PlayBuffer() override;
+
+private:
+	const CRegisterTrace &trace_;
+	stRenderSettings settings_;
+
+	std::unique_ptr<CAPU> apu_;
+	std::unique_ptr<CVGMWriter> vgm_;
+	COutputWaveStream *stream_ = nullptr;
+	unsigned frames_ = 0u;
+	std::size_t samples_ = 0u;
+	std::vector<std::uint8_t> conv_;
+};
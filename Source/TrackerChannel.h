@@ -30,6 +30,7 @@
 #include "APU/Types_fwd.h"		// // //
 
 enum inst_type_t : unsigned;
+class CStateArchive;		// // //
 
 enum note_prio_t : unsigned {
 	NOTE_PRIO_0,
@@ -54,6 +55,8 @@ public:
 	void SetPitch(int Pitch);
 	int GetPitch() const;
 
+	void SerializeState(CStateArchive &ar);		// // // queued note only, pitch and meter belong to the UI
+
 private:
 	stChanNote m_Note;
 	note_prio_t m_iNotePriority = NOTE_PRIO_0;
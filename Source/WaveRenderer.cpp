@@ -22,6 +22,7 @@
 
 #include "WaveRenderer.h"
 #include "NumConv.h"
+#include "StateArchive.h"		// // //
 
 CWaveRenderer::~CWaveRenderer() {
 	CloseOutputStream();
@@ -38,7 +39,8 @@ void CWaveRenderer::CloseOutputStream() {
 
 void CWaveRenderer::Start() {
 	m_bStarted = true;
-	m_pWaveStream->WriteWAVHeader();
+	if (m_pWaveStream)		// // //
+		m_pWaveStream->WriteWAVHeader();
 }
 
 bool CWaveRenderer::ShouldStartPlayer() {
@@ -77,6 +79,11 @@ int CWaveRenderer::GetRenderTrack() const {
 	return m_iRenderTrack;
 }
 
+void CWaveRenderer::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_bStarted, m_bFinished, m_bRequestRenderStop, m_bStoppingRender,
+		m_iDelayedStart, m_iDelayedEnd, m_iRenderRowCount);
+}
+
 void CWaveRenderer::FinishRender() {
 	m_bRequestRenderStop = true;
 }
@@ -105,6 +112,11 @@ int CWaveRendererTick::GetProgressPercent() const {
 	return Finished() ? 100 : m_iRenderTick * 100 / m_iTicksToRender;
 }
 
+void CWaveRendererTick::SerializeState(CStateArchive &ar) {		// // //
+	CWaveRenderer::SerializeState(ar);
+	ar(m_iRenderTick);
+}
+
 
 
 CWaveRendererRow::CWaveRendererRow(unsigned Rows) :
@@ -127,3 +139,8 @@ std::string CWaveRendererRow::GetProgressString() const {
 int CWaveRendererRow::GetProgressPercent() const {
 	return Finished() ? 100 : m_iRenderRow * 100 / m_iRowsToRender;
 }
+
+void CWaveRendererRow::SerializeState(CStateArchive &ar) {		// // //
+	CWaveRenderer::SerializeState(ar);
+	ar(m_iRenderRow);
+}
@@ -29,6 +29,8 @@
 #include "array_view.h"
 #include "WaveStream.h"
 
+class CStateArchive;		// // //
+
 class CWaveRenderer {
 public:
 	virtual ~CWaveRenderer();
@@ -58,6 +60,8 @@ public:
 	virtual std::string GetProgressString() const = 0;
 	virtual int GetProgressPercent() const = 0;
 
+	virtual void SerializeState(CStateArchive &ar);		// // // progress only, not the output stream
+
 protected:
 	void FinishRender();
 
@@ -82,6 +86,7 @@ private:
 	void Tick() override;
 	std::string GetProgressString() const override;
 	int GetProgressPercent() const override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	unsigned m_iTicksToRender;
@@ -97,6 +102,7 @@ private:
 	void StepRow() override;
 	std::string GetProgressString() const override;
 	int GetProgressPercent() const override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	unsigned m_iRowsToRender;